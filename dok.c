@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,16 +6,37 @@
 #include <termios.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <ctype.h>
 #include <regex.h>
+#include <fnmatch.h>
 #include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/inotify.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#define MAX_LINE_LENGTH 1024
 #define MAX_ITEMS 100
 #define MAX_NAME_LENGTH 128
 #define MAX_CONTENT_LENGTH 512
 #define MAX_PATH_LENGTH 256
+#define MAX_SCAN_THREADS 64
+#define WATCH_SETTLE_MS 150
+#define WATCH_MAX_DELAY_MS 2000
+#define SCAN_REFRESH_MS 100        // how often a running scan is shown on screen
 #define DOCS_FILE ".project_docs.txt"
+#define JOURNAL_FILE ".project_docs.journal"
+#define JOURNAL_COMPACT_BYTES (256 * 1024)
+#define GROUP_COMMIT_MS 200        // window coalescing journal fsyncs
+#define CACHE_FILE ".dok_cache"
+#define CACHE_MAGIC "DOKC"
+#define CACHE_VERSION 3
 
 // ANSI color codes
 #define RESET "\033[0m"
@@ -36,44 +58,118 @@ typedef enum {
     STATE_UNDOCUMENTED
 } nav_state_t;
 
-// Function information - simplified, removed parameter parsing
+// What produced the search results
+typedef enum {
+    SEARCH_QUERY,               // live_search()
+    SEARCH_FUZZY,               // fuzzy_search()
+    SEARCH_CALLERS,             // find_callers() of docs.xref_file::xref_name
+    SEARCH_CALLEES,             // find_callees() of the same
+    SEARCH_DEFINITIONS          // find_definitions() of docs.search_term
+} search_source_t;
+
+// Documentation text. Kept out of function_t so that list views and
+// coverage counting only touch parse metadata; allocated the first time a
+// function gets documentation. Fields are never NULL.
 typedef struct {
-    char name[MAX_NAME_LENGTH];
-    char signature[MAX_NAME_LENGTH];
-    char filename[MAX_PATH_LENGTH];
+    char *description;
+    char *parameters;
+    char *return_value;
+    char *example;
+    char *notes;
+} function_docs_t;
+
+// Handle into the project-wide string table, see intern()
+typedef uint32_t str_id_t;
+#define NO_STRING UINT32_MAX
+
+// Function information - simplified, removed parameter parsing.
+// Fields used by list views come first.
+typedef struct {
+    str_id_t name;
     int line_number;
-    // Documentation fields
-    char description[MAX_CONTENT_LENGTH];
-    char parameters[MAX_CONTENT_LENGTH];
-    char return_value[MAX_CONTENT_LENGTH];
-    char example[MAX_CONTENT_LENGTH];
-    char notes[MAX_CONTENT_LENGTH];
     int is_documented;
     // Only keep return type parsing
-    char return_type[MAX_NAME_LENGTH];
+    str_id_t return_type;
+    str_id_t signature;
+    str_id_t filename;
+    function_docs_t *docs;      // NULL until documented
 } function_t;
 
+// A function by position: docs.files[file]->functions[func]
+typedef struct {
+    uint32_t file;
+    uint32_t func;
+} func_ref_t;
+
+// Documentation coverage of a file or the project, see file_coverage()
+typedef struct {
+    int functions;
+    int documented;
+} coverage_t;
+
+// Bump allocator. Blocks start small and double, so a file with a handful
+// of functions costs a few hundred bytes while huge files still get few
+// large blocks. Everything is released at once by arena_free().
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} arena_block_t;
+
+typedef struct {
+    arena_block_t *head;
+    size_t next_size;
+} arena_t;
+
 // File information
 typedef struct {
-    char filename[MAX_PATH_LENGTH];
-    char full_path[MAX_PATH_LENGTH];
-    function_t functions[MAX_ITEMS];
+    str_id_t filename;          // path relative to the project root
+    arena_t arena;              // owns everything hanging off this record
+    function_t *functions;      // function_count entries, allocated in `arena`
     int function_count;
+    int documented_count;       // functions with is_documented set
+    // Identifiers used in each function's body, once each: function j's are
+    // body_words[body_offsets[j] .. body_offsets[j + 1]), the ones it calls
+    // (followed by '(') first, up to call_ends[j]. All in `arena`;
+    // body_offsets is NULL when nothing was recorded.
+    str_id_t *body_words;
+    uint32_t *body_offsets;
+    uint32_t *call_ends;
+    // Identity of the parsed contents, used to skip unchanged files on rescan
+    time_t mtime;
+    off_t size;
+    ino_t inode;
+    uint64_t hash;              // content hash, see hash_bytes()
 } source_file_t;
 
 // Global state - use static to control memory layout
 static struct {
-    source_file_t files[MAX_ITEMS];
+    source_file_t **files;      // sorted by filename
     int file_count;
+    int file_capacity;
+    coverage_t coverage;        // totals over files, see count_coverage()
+    int complete;               // a scan has listed every file and its documentation is loaded
     int current_file;
     int current_function;
     int current_selection;
+    int list_top;               // first list row on screen, see list_viewport()
+    int list_rows;              // list rows that fit on screen
     nav_state_t state;
     char search_term[MAX_NAME_LENGTH];
-    int search_results[MAX_ITEMS];
+    func_ref_t *search_results;
     int search_count;
-    function_t *undocumented_functions[MAX_ITEMS];
+    int search_capacity;
+    int search_complete;        // search_results holds every match
+    search_source_t search_source;
+    str_id_t xref_file;         // the function whose callers or callees are listed
+    str_id_t xref_name;
+    int search_editing;         // keys go to the live search query
+    int search_stale;           // the query changed but hasn't been run yet
+    char search_error[MAX_NAME_LENGTH];
+    function_t **undocumented_functions;
     int undocumented_count;
+    int undocumented_capacity;
 } docs;
 
 // Terminal handling - make static
@@ -92,14 +188,37 @@ void enable_raw_mode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 }
 
+// Views are drawn into frames, see begin_frame(); this is what the
+// renderer knows about the terminal
+typedef struct {
+    char text[4];               // one UTF-8 character, NUL-padded
+    uint8_t attr;               // SGR state: foreground 0 (default) or 1-8, plus ATTR_BOLD
+} cell_t;
+
+static struct {
+    FILE *terminal;             // the real stdout while a frame is composed
+    FILE *stream;               // collects the frame, NULL outside one
+    char *text;
+    size_t text_size;
+    cell_t *front;              // what the terminal shows
+    cell_t *back;               // the frame being presented
+    int rows, cols;
+    int front_valid;            // 0 once anything else wrote to the terminal
+    char *out;                  // escape sequences for one present
+    int out_size, out_capacity;
+} screen;
+
+// Inside a frame a view starts on a blank frame anyway
 void clear_screen() {
+    if (screen.stream) return;
     printf("\033[2J\033[H");
 }
 
 // Forward declarations
-void extract_return_type(const char *signature, char *return_type);
+void extract_return_type(const char *signature, size_t len, char *return_type);
 void save_as_text(source_file_t *file, const char *filename, struct tm *tm_info);
 void save_as_markdown(source_file_t *file, const char *filename, struct tm *tm_info);
+static int find_file_index(const char *path);
 void save_as_html(source_file_t *file, const char *filename, struct tm *tm_info);
 void save_as_postscript(source_file_t *file, const char *filename, struct tm *tm_info);
 void write_function_docs_text(FILE *f, source_file_t *file);
@@ -107,6 +226,224 @@ void write_function_docs_markdown(FILE *f, source_file_t *file);
 void write_function_docs_html(FILE *f, source_file_t *file);
 void write_function_docs_postscript(FILE *f, source_file_t *file);
 
+// Memory management
+#define ARENA_MIN_BLOCK 256
+#define ARENA_MAX_BLOCK (1 << 20)
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    
+    arena_block_t *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        size_t block_size = arena->next_size ? arena->next_size : ARENA_MIN_BLOCK;
+        if (arena->next_size < ARENA_MAX_BLOCK) arena->next_size = block_size * 2;
+        if (block_size < size) block_size = size;
+        
+        block = malloc(sizeof(arena_block_t) + block_size);
+        if (!block) return NULL;
+        block->next = arena->head;
+        block->used = 0;
+        block->size = block_size;
+        arena->head = block;
+    }
+    
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void arena_free(arena_t *arena) {
+    arena_block_t *block = arena->head;
+    while (block) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->next_size = 0;
+}
+
+// Grow a heap array to hold at least `needed` elements
+int grow_array(void **array, int *capacity, int needed, size_t element_size) {
+    if (needed <= *capacity) return 1;
+    
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) new_capacity *= 2;
+    
+    void *grown = realloc(*array, (size_t)new_capacity * element_size);
+    if (!grown) return 0;
+    *array = grown;
+    *capacity = new_capacity;
+    return 1;
+}
+
+// String table
+//
+// Names, return types, signatures and paths are interned once and referred
+// to by 32-bit ids, so equal strings compare as equal ids. Strings live in
+// an arena and are never freed. Lookups go through a hash table under a
+// lock (scanner workers intern concurrently), but str() is lock-free: the
+// id -> string pages never move, and an id is only handed out after its
+// entry has been written.
+#define STR_PAGE_BITS 12
+#define STR_PAGE_SIZE (1 << STR_PAGE_BITS)
+#define STR_MAX_PAGES (1 << 16)
+
+static struct {
+    pthread_mutex_t lock;
+    const char **pages[STR_MAX_PAGES];
+    uint32_t count;
+    uint32_t *slots;            // open addressing, holds id + 1 (0 = empty)
+    uint32_t capacity;
+    arena_t arena;
+} strings = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+const char *str(str_id_t id) {
+    return strings.pages[id >> STR_PAGE_BITS][id & (STR_PAGE_SIZE - 1)];
+}
+
+static uint32_t hash_string(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Caller must hold strings.lock. Returns the slot holding `s`, or the
+// empty slot where it would go.
+static uint32_t *string_slot(const char *s, size_t len, uint32_t hash) {
+    uint32_t mask = strings.capacity - 1;
+    for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+        uint32_t *slot = &strings.slots[i];
+        if (*slot == 0) return slot;
+        const char *candidate = str(*slot - 1);
+        if (strncmp(candidate, s, len) == 0 && candidate[len] == '\0') return slot;
+    }
+}
+
+static int grow_string_slots() {
+    uint32_t capacity = strings.capacity ? strings.capacity * 2 : 4096;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (!slots) return 0;
+    
+    uint32_t *old = strings.slots;
+    uint32_t old_capacity = strings.capacity;
+    strings.slots = slots;
+    strings.capacity = capacity;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old[i] == 0) continue;
+        const char *s = str(old[i] - 1);
+        size_t len = strlen(s);
+        *string_slot(s, len, hash_string(s, len)) = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+str_id_t intern_n(const char *s, size_t len) {
+    uint32_t hash = hash_string(s, len);
+    
+    pthread_mutex_lock(&strings.lock);
+    if ((strings.count + 1) * 4 >= strings.capacity * 3 && !grow_string_slots()) {
+        pthread_mutex_unlock(&strings.lock);
+        return 0;
+    }
+    
+    uint32_t *slot = string_slot(s, len, hash);
+    if (*slot == 0) {
+        str_id_t id = strings.count;
+        const char ***page = &strings.pages[id >> STR_PAGE_BITS];
+        char *copy = arena_alloc(&strings.arena, len + 1);
+        if (!*page) *page = calloc(STR_PAGE_SIZE, sizeof(char *));
+        if (!copy || !*page || (id >> STR_PAGE_BITS) >= STR_MAX_PAGES - 1) {
+            pthread_mutex_unlock(&strings.lock);
+            return 0;  // out of memory: degrade to the empty string
+        }
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+        (*page)[id & (STR_PAGE_SIZE - 1)] = copy;
+        strings.count++;
+        *slot = id + 1;
+    }
+    str_id_t id = *slot - 1;
+    pthread_mutex_unlock(&strings.lock);
+    
+    return id;
+}
+
+str_id_t intern(const char *s) {
+    return intern_n(s, strlen(s));
+}
+
+// Like intern(), but never adds: returns NO_STRING if `s` is not in the table
+str_id_t find_string(const char *s) {
+    size_t len = strlen(s);
+    uint32_t hash = hash_string(s, len);
+    
+    pthread_mutex_lock(&strings.lock);
+    str_id_t id = NO_STRING;
+    if (strings.capacity) {
+        uint32_t *slot = string_slot(s, len, hash);
+        if (*slot) id = *slot - 1;
+    }
+    pthread_mutex_unlock(&strings.lock);
+    
+    return id;
+}
+
+// Documentation store
+static char empty_text[] = "";
+static const function_docs_t no_docs = { empty_text, empty_text, empty_text, empty_text, empty_text };
+
+// Read access; undocumented functions share an all-empty record
+const function_docs_t *get_docs(const function_t *func) {
+    return func->docs ? func->docs : &no_docs;
+}
+
+// Write access; allocates the record on first use
+function_docs_t *edit_docs(function_t *func) {
+    if (!func->docs) {
+        func->docs = malloc(sizeof(function_docs_t));
+        if (!func->docs) return NULL;
+        *func->docs = no_docs;
+    }
+    return func->docs;
+}
+
+void set_doc_text(char **field, const char *text) {
+    char *copy = *text ? strdup(text) : empty_text;
+    if (!copy) return;
+    if (*field != empty_text) free(*field);
+    *field = copy;
+}
+
+void free_function_docs(function_docs_t *doc) {
+    if (!doc) return;
+    set_doc_text(&doc->description, "");
+    set_doc_text(&doc->parameters, "");
+    set_doc_text(&doc->return_value, "");
+    set_doc_text(&doc->example, "");
+    set_doc_text(&doc->notes, "");
+    free(doc);
+}
+
+source_file_t *new_source_file(const char *path) {
+    source_file_t *file = calloc(1, sizeof(source_file_t));
+    if (!file) return NULL;
+    file->filename = intern(path);
+    return file;
+}
+
+void free_source_file(source_file_t *file) {
+    if (!file) return;
+    for (int i = 0; i < file->function_count; i++) {
+        free_function_docs(file->functions[i].docs);
+    }
+    arena_free(&file->arena);
+    free(file);
+}
+
 // Utility functions
 void trim_whitespace(char *str) {
     char *end;
@@ -128,10 +465,11 @@ int is_c_file(const char *filename) {
 }
 
 // Extract return type from function signature
-void extract_return_type(const char *signature, char *return_type) {
+void extract_return_type(const char *signature, size_t len, char *return_type) {
     char temp[MAX_NAME_LENGTH];
-    strncpy(temp, signature, MAX_NAME_LENGTH - 1);
-    temp[MAX_NAME_LENGTH - 1] = '\0';
+    if (len > MAX_NAME_LENGTH - 1) len = MAX_NAME_LENGTH - 1;
+    memcpy(temp, signature, len);
+    temp[len] = '\0';
     
     // Find the function name (before the opening parenthesis)
     char *paren = strchr(temp, '(');
@@ -162,262 +500,4516 @@ void extract_return_type(const char *signature, char *return_type) {
         strncpy(return_type, temp, MAX_NAME_LENGTH - 1);
         return_type[MAX_NAME_LENGTH - 1] = '\0';
     }
-}
-
-// C file parsing functions
-int extract_function_name(const char *signature, char *name) {
-    // Simple function name extraction - looks for pattern: type name(
-    char *paren = strchr(signature, '(');
-    if (!paren) return 0;
+}
+
+// C file parsing functions
+//
+// Lines are handled as (pointer, length) spans into the mapped file so the
+// parser never copies or allocates until it has found a function.
+int extract_function_name(const char *line, size_t len, const char **name, size_t *name_len) {
+    // Simple function name extraction - looks for pattern: type name(
+    const char *paren = memchr(line, '(', len);
+    if (!paren) return 0;
+    
+    // Go backwards from ( to find function name
+    const char *start = paren;
+    while (start > line && (isalnum((unsigned char)start[-1]) || start[-1] == '_')) {
+        start--;
+    }
+    
+    // Skip if no valid name found
+    if (start >= paren) return 0;
+    
+    *name = start;
+    *name_len = paren - start;
+    return 1;
+}
+
+static int span_starts_with(const char *line, size_t len, const char *prefix) {
+    size_t prefix_len = strlen(prefix);
+    return len >= prefix_len && memcmp(line, prefix, prefix_len) == 0;
+}
+
+// `line` has already had trailing whitespace removed
+int is_function_line(const char *line, size_t len, int is_header) {
+    if (len == 0) return 0;
+    
+    // Skip obvious non-function lines
+    if (span_starts_with(line, len, "//")) return 0;  // Comment
+    if (span_starts_with(line, len, "/*")) return 0;  // Comment
+    if (span_starts_with(line, len, "#")) return 0;   // Preprocessor
+    if (span_starts_with(line, len, "typedef")) return 0;
+    if (span_starts_with(line, len, "struct")) return 0;
+    if (span_starts_with(line, len, "enum")) return 0;
+    if (span_starts_with(line, len, "union")) return 0;
+    
+    // Skip function calls (likely indented)
+    if (line[0] == ' ' || line[0] == '\t') return 0;
+    
+    // Must contain parentheses
+    if (!memchr(line, '(', len) || !memchr(line, ')', len)) return 0;
+    
+    // In headers, accept both declarations and definitions;
+    // in .c files, only accept definitions (not ending with semicolon)
+    return is_header || line[len - 1] != ';';
+}
+
+// Function bodies
+//
+// A definition's body is found by matching braces from its signature,
+// skipping comments and string and character literals, and the identifiers
+// inside are recorded once per function, leaving out C keywords and single
+// letters. Identifiers followed by '(' are calls and are kept first. Words
+// are collected in a per-thread vocabulary for the file being parsed, so
+// each distinct word is interned once per file however many functions use
+// it.
+typedef struct {
+    const char *text;
+    uint32_t len;
+    uint32_t last_function;     // function index + 1 that last used it
+    uint32_t called_in;         // function index + 1 that last called it
+    int skip;                   // keyword or too short to be worth indexing
+} body_word_t;
+
+static const char *const c_keywords[] = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do", "double",
+    "else", "enum", "extern", "float", "for", "goto", "if", "inline", "int", "long",
+    "register", "restrict", "return", "short", "signed", "sizeof", "static", "struct",
+    "switch", "typedef", "union", "unsigned", "void", "volatile", "while", NULL
+};
+
+static __thread body_word_t *vocab;
+static __thread int vocab_count, vocab_capacity;
+static __thread uint32_t *vocab_slots;     // open addressing, holds index + 1
+static __thread uint32_t vocab_slot_capacity;
+static __thread uint32_t *body_scratch;    // vocabulary indices, function after function
+static __thread int body_scratch_count, body_scratch_capacity;
+static __thread uint32_t *body_offset_scratch;
+static __thread int body_offset_capacity;
+static __thread uint32_t *call_count_scratch;
+static __thread int call_count_capacity;
+
+// Release this thread's buffers; a thread that exits without it leaks them
+static void free_vocabulary() {
+    free(vocab);
+    free(vocab_slots);
+    free(body_scratch);
+    free(body_offset_scratch);
+    free(call_count_scratch);
+    vocab = NULL;
+    vocab_slots = NULL;
+    body_scratch = NULL;
+    body_offset_scratch = NULL;
+    call_count_scratch = NULL;
+    vocab_count = vocab_capacity = 0;
+    vocab_slot_capacity = 0;
+    body_scratch_count = body_scratch_capacity = 0;
+    body_offset_capacity = call_count_capacity = 0;
+}
+
+static void reset_vocabulary() {
+    vocab_count = 0;
+    body_scratch_count = 0;
+    if (vocab_slots) memset(vocab_slots, 0, vocab_slot_capacity * sizeof(uint32_t));
+}
+
+static int grow_vocabulary_slots() {
+    uint32_t capacity = vocab_slot_capacity ? vocab_slot_capacity * 2 : 1024;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (!slots) return 0;
+    
+    for (int i = 0; i < vocab_count; i++) {
+        uint32_t slot = hash_string(vocab[i].text, vocab[i].len) & (capacity - 1);
+        while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = i + 1;
+    }
+    free(vocab_slots);
+    vocab_slots = slots;
+    vocab_slot_capacity = capacity;
+    return 1;
+}
+
+// Index of the word in this file's vocabulary, adding it if new; -1 if out of memory
+static int vocabulary_index(const char *text, size_t len) {
+    if ((uint32_t)(vocab_count + 1) * 4 >= vocab_slot_capacity * 3 && !grow_vocabulary_slots()) return -1;
+    
+    uint32_t mask = vocab_slot_capacity - 1;
+    uint32_t slot = hash_string(text, len) & mask;
+    for (; vocab_slots[slot]; slot = (slot + 1) & mask) {
+        body_word_t *word = &vocab[vocab_slots[slot] - 1];
+        if (word->len == len && memcmp(word->text, text, len) == 0) return vocab_slots[slot] - 1;
+    }
+    
+    if (!grow_array((void **)&vocab, &vocab_capacity, vocab_count + 1, sizeof(body_word_t))) return -1;
+    body_word_t *word = &vocab[vocab_count];
+    word->text = text;
+    word->len = len;
+    word->last_function = 0;
+    word->called_in = 0;
+    word->skip = len < 2;
+    for (int i = 0; c_keywords[i] && !word->skip; i++) {
+        word->skip = strlen(c_keywords[i]) == len && memcmp(c_keywords[i], text, len) == 0;
+    }
+    vocab_slots[slot] = vocab_count + 1;
+    return vocab_count++;
+}
+
+static void scan_body(const char *p, const char *end, uint32_t function) {
+    int parens = 0;
+    for (; p < end; p++) {
+        if (*p == '(') parens++;
+        else if (*p == ')') parens--;
+        else if (parens == 0 && (*p == ';' || *p == '=' || *p == '}')) return;
+        else if (parens == 0 && *p == '{') break;
+    }
+    
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '/' && p + 1 < end && p[1] == '/') {
+            p = memchr(p, '\n', end - p);
+            if (!p) return;
+        } else if (c == '/' && p + 1 < end && p[1] == '*') {
+            p = memmem(p + 2, end - p - 2, "*/", 2);
+            if (!p) return;
+            p += 2;
+        } else if (c == '"' || c == '\'') {
+            for (p++; p < end && *p != c && *p != '\n'; p++) {
+                if (*p == '\\') p++;
+            }
+            p++;
+        } else if (isalpha((unsigned char)c) || c == '_') {
+            const char *start = p;
+            while (p < end && (isalnum((unsigned char)*p) || *p == '_')) p++;
+            
+            int index = vocabulary_index(start, p - start);
+            if (index < 0 || vocab[index].skip) continue;
+            
+            const char *next = p;
+            while (next < end && (*next == ' ' || *next == '\t')) next++;
+            if (next < end && *next == '(') vocab[index].called_in = function + 1;
+            if (vocab[index].last_function == function + 1) continue;
+            if (!grow_array((void **)&body_scratch, &body_scratch_capacity, body_scratch_count + 1,
+                            sizeof(uint32_t))) continue;
+            vocab[index].last_function = function + 1;
+            body_scratch[body_scratch_count++] = index;
+        } else if (isdigit((unsigned char)c)) {
+            while (p < end && (isalnum((unsigned char)*p) || *p == '_' || *p == '.')) p++;
+        } else {
+            if (c == '{') depth++;
+            else if (c == '}' && --depth == 0) return;
+            p++;
+        }
+    }
+}
+
+// Record the identifiers in the body of the definition whose signature
+// starts at `p`, calls first. Returns the number of calls. Declarations
+// and anything that isn't followed by a body record nothing.
+static uint32_t record_body(const char *p, const char *end, uint32_t function) {
+    int begin = body_scratch_count;
+    scan_body(p, end, function);
+    
+    // Swapping calls forward keeps them in the order they first appear
+    int calls = begin;
+    for (int k = begin; k < body_scratch_count; k++) {
+        if (vocab[body_scratch[k]].called_in != function + 1) continue;
+        uint32_t word = body_scratch[k];
+        body_scratch[k] = body_scratch[calls];
+        body_scratch[calls++] = word;
+    }
+    return calls - begin;
+}
+
+// Move the words recorded while parsing into the file's arena. Must run
+// before the file is unmapped: the vocabulary points into it.
+static void store_bodies(source_file_t *file, int function_count) {
+    file->body_words = NULL;
+    file->body_offsets = arena_alloc(&file->arena, (function_count + 1) * sizeof(uint32_t));
+    file->call_ends = arena_alloc(&file->arena, (function_count ? function_count : 1) * sizeof(uint32_t));
+    if (!file->body_offsets || !file->call_ends) {
+        file->body_offsets = NULL;
+        return;
+    }
+    memcpy(file->body_offsets, body_offset_scratch, (function_count + 1) * sizeof(uint32_t));
+    for (int j = 0; j < function_count; j++) {
+        file->call_ends[j] = body_offset_scratch[j] + call_count_scratch[j];
+    }
+    
+    // Intern each word once, reusing last_function to hold its id
+    for (int i = 0; i < vocab_count; i++) {
+        if (!vocab[i].skip && vocab[i].last_function) {
+            vocab[i].last_function = intern_n(vocab[i].text, vocab[i].len);
+        }
+    }
+    
+    file->body_words = arena_alloc(&file->arena, (body_scratch_count ? body_scratch_count : 1) * sizeof(str_id_t));
+    if (!file->body_words) {
+        file->body_offsets = NULL;
+        return;
+    }
+    for (int i = 0; i < body_scratch_count; i++) {
+        file->body_words[i] = vocab[body_scratch[i]].last_function;
+    }
+}
+
+// Persistent parse cache
+//
+// CACHE_FILE holds, for every file of the last scan, its stat identity,
+// content hash and parsed functions, so a restart only parses files that
+// actually changed. Layout (native byte order, no padding):
+//
+//   header:   "DOKC" u32 version u32 file_count
+//   file:     i64 mtime i64 size u64 inode u64 hash u32 function_count
+//             u16 path_len path u32 word_count (u16 len word)*word_count
+//   function: i32 line_number u16 len name u16 len signature u16 len return_type
+//             u32 body_count u32 call_count u32*body_count
+//
+// The words are the file's body vocabulary; a function's body entries
+// index into it, the first call_count of them being calls.
+// The file is mapped read-only and validated once when loaded; anything
+// malformed or from another version is ignored and rebuilt.
+typedef struct {
+    const char *path;
+    uint16_t path_len;
+    int64_t mtime;
+    int64_t size;
+    uint64_t inode;
+    uint64_t hash;
+    uint32_t function_count;
+    uint32_t word_count;
+    const unsigned char *words;
+    const unsigned char *functions;
+} cache_entry_t;
+
+static struct {
+    unsigned char *data;
+    size_t size;
+    cache_entry_t *entries;
+    int count;
+} cache;
+
+static uint64_t hash_bytes(const char *data, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    
+    // FNV-1a style mixing, a word at a time
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001b3ULL;
+        h ^= h >> 32;
+    }
+    for (; i < len; i++) {
+        h = (h ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Bounds-checked reader over the mapped cache
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+} cache_cursor_t;
+
+static int cache_read(cache_cursor_t *c, void *out, size_t len) {
+    if ((size_t)(c->end - c->p) < len) return 0;
+    memcpy(out, c->p, len);
+    c->p += len;
+    return 1;
+}
+
+static int cache_read_string(cache_cursor_t *c, const char **str, uint16_t *len) {
+    if (!cache_read(c, len, sizeof(*len)) || (size_t)(c->end - c->p) < *len) return 0;
+    *str = (const char *)c->p;
+    c->p += *len;
+    return 1;
+}
+
+static int cache_skip_functions(cache_cursor_t *c, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t line;
+        const char *str;
+        uint16_t len;
+        if (!cache_read(c, &line, sizeof(line))) return 0;
+        for (int field = 0; field < 3; field++) {
+            if (!cache_read_string(c, &str, &len)) return 0;
+        }
+        
+        uint32_t body_count, call_count;
+        if (!cache_read(c, &body_count, sizeof(body_count)) ||
+            !cache_read(c, &call_count, sizeof(call_count)) || call_count > body_count ||
+            (size_t)(c->end - c->p) / sizeof(uint32_t) < body_count) return 0;
+        c->p += body_count * sizeof(uint32_t);
+    }
+    return 1;
+}
+
+static int cache_skip_words(cache_cursor_t *c, uint32_t count) {
+    const char *str;
+    uint16_t len;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!cache_read_string(c, &str, &len)) return 0;
+    }
+    return 1;
+}
+
+static int compare_cache_entries(const void *a, const void *b) {
+    const cache_entry_t *ea = a, *eb = b;
+    int cmp = memcmp(ea->path, eb->path, ea->path_len < eb->path_len ? ea->path_len : eb->path_len);
+    return cmp ? cmp : (int)ea->path_len - (int)eb->path_len;
+}
+
+void unload_cache() {
+    if (cache.data) munmap(cache.data, cache.size);
+    free(cache.entries);
+    memset(&cache, 0, sizeof(cache));
+}
+
+void load_cache() {
+    int fd = open(CACHE_FILE, O_RDONLY);
+    if (fd < 0) return;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 12) {
+        close(fd);
+        return;
+    }
+    cache.data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (cache.data == MAP_FAILED) {
+        cache.data = NULL;
+        return;
+    }
+    cache.size = st.st_size;
+    
+    cache_cursor_t c = { cache.data, cache.data + cache.size };
+    char magic[4];
+    uint32_t version, count;
+    if (!cache_read(&c, magic, 4) || memcmp(magic, CACHE_MAGIC, 4) != 0 ||
+        !cache_read(&c, &version, sizeof(version)) || version != CACHE_VERSION ||
+        !cache_read(&c, &count, sizeof(count)) || count > cache.size / 42) {
+        unload_cache();
+        return;
+    }
+    
+    cache.entries = malloc((count ? count : 1) * sizeof(cache_entry_t));
+    if (!cache.entries) {
+        unload_cache();
+        return;
+    }
+    
+    int sorted = 1;
+    for (uint32_t i = 0; i < count; i++) {
+        cache_entry_t *e = &cache.entries[i];
+        if (!cache_read(&c, &e->mtime, sizeof(e->mtime)) ||
+            !cache_read(&c, &e->size, sizeof(e->size)) ||
+            !cache_read(&c, &e->inode, sizeof(e->inode)) ||
+            !cache_read(&c, &e->hash, sizeof(e->hash)) ||
+            !cache_read(&c, &e->function_count, sizeof(e->function_count)) ||
+            !cache_read_string(&c, &e->path, &e->path_len) ||
+            !cache_read(&c, &e->word_count, sizeof(e->word_count))) {
+            unload_cache();
+            return;
+        }
+        e->words = c.p;
+        if (!cache_skip_words(&c, e->word_count)) {
+            unload_cache();
+            return;
+        }
+        e->functions = c.p;
+        if (!cache_skip_functions(&c, e->function_count)) {
+            unload_cache();
+            return;
+        }
+        if (i > 0 && compare_cache_entries(&cache.entries[i - 1], e) > 0) sorted = 0;
+    }
+    cache.count = count;
+    
+    if (!sorted) qsort(cache.entries, cache.count, sizeof(cache_entry_t), compare_cache_entries);
+}
+
+const cache_entry_t *find_cache_entry(const char *path) {
+    cache_entry_t key = { .path = path, .path_len = strlen(path) };
+    return cache.count ? bsearch(&key, cache.entries, cache.count, sizeof(cache_entry_t),
+                                 compare_cache_entries) : NULL;
+}
+
+static str_id_t intern_cache_string(cache_cursor_t *c) {
+    const char *text = "";
+    uint16_t len = 0;
+    cache_read_string(c, &text, &len);
+    return intern_n(text, len);
+}
+
+static void restore_from_cache(const cache_entry_t *entry, source_file_t *file) {
+    cache_cursor_t c = { entry->words, cache.data + cache.size };
+    
+    file->function_count = 0;
+    file->functions = arena_alloc(&file->arena, entry->function_count * sizeof(function_t));
+    file->body_offsets = arena_alloc(&file->arena, (entry->function_count + 1) * sizeof(uint32_t));
+    file->call_ends = arena_alloc(&file->arena, (entry->function_count + 1) * sizeof(uint32_t));
+    str_id_t *words = malloc((entry->word_count ? entry->word_count : 1) * sizeof(str_id_t));
+    if (!file->functions || !file->body_offsets || !file->call_ends || !words) {
+        file->body_offsets = NULL;
+        free(words);
+        return;
+    }
+    
+    for (uint32_t i = 0; i < entry->word_count; i++) {
+        words[i] = intern_cache_string(&c);
+    }
+    
+    // Body entries of all functions, sized once the counts are known
+    uint32_t body_total = 0;
+    file->body_words = NULL;
+    
+    for (uint32_t i = 0; i < entry->function_count; i++) {
+        function_t *func = &file->functions[file->function_count++];
+        int32_t line = 0;
+        
+        memset(func, 0, sizeof(function_t));
+        cache_read(&c, &line, sizeof(line));
+        func->line_number = line;
+        func->name = intern_cache_string(&c);
+        func->signature = intern_cache_string(&c);
+        func->return_type = intern_cache_string(&c);
+        func->filename = file->filename;
+        
+        uint32_t body_count = 0, call_count = 0;
+        cache_read(&c, &body_count, sizeof(body_count));
+        cache_read(&c, &call_count, sizeof(call_count));
+        file->body_offsets[i] = body_total;
+        file->call_ends[i] = body_total;
+        if (body_count && grow_array((void **)&body_scratch, &body_scratch_capacity,
+                                     body_total + body_count, sizeof(uint32_t))) {
+            for (uint32_t k = 0; k < body_count; k++) {
+                uint32_t index = 0;
+                cache_read(&c, &index, sizeof(index));
+                if (index < entry->word_count) body_scratch[body_total++] = words[index];
+                if (k + 1 == call_count) file->call_ends[i] = body_total;
+            }
+        } else {
+            c.p += body_count * sizeof(uint32_t);
+        }
+    }
+    file->body_offsets[entry->function_count] = body_total;
+    
+    file->body_words = arena_alloc(&file->arena, (body_total ? body_total : 1) * sizeof(str_id_t));
+    if (file->body_words) {
+        memcpy(file->body_words, body_scratch, body_total * sizeof(str_id_t));
+    } else {
+        file->body_offsets = NULL;
+    }
+    free(words);
+    file->hash = entry->hash;
+}
+
+static void write_cache_string(FILE *f, str_id_t id) {
+    const char *text = str(id);
+    size_t len = strlen(text);
+    uint16_t stored = len > UINT16_MAX ? UINT16_MAX : len;
+    fwrite(&stored, sizeof(stored), 1, f);
+    fwrite(text, 1, stored, f);
+}
+
+// Per-save scratch for turning body word ids back into a file vocabulary:
+// stamp[id] == file_stamp marks ids already given an index in this file
+static struct {
+    uint32_t *stamp;
+    uint32_t *index;
+    int capacity;
+    uint32_t file_stamp;
+    str_id_t *words;
+    int word_capacity;
+} cache_vocab;
+
+static int collect_cache_vocabulary(const source_file_t *file) {
+    if (!file->body_offsets) return 0;
+    
+    int old_capacity = cache_vocab.capacity;
+    int needed = strings.count;
+    if (!grow_array((void **)&cache_vocab.stamp, &cache_vocab.capacity, needed, sizeof(uint32_t))) return 0;
+    int grown_capacity = cache_vocab.capacity;
+    cache_vocab.capacity = old_capacity;
+    if (!grow_array((void **)&cache_vocab.index, &cache_vocab.capacity, needed, sizeof(uint32_t))) return 0;
+    memset(cache_vocab.stamp + old_capacity, 0, (grown_capacity - old_capacity) * sizeof(uint32_t));
+    
+    uint32_t total = file->body_offsets[file->function_count];
+    int count = 0;
+    cache_vocab.file_stamp++;
+    for (uint32_t i = 0; i < total; i++) {
+        str_id_t id = file->body_words[i];
+        if (cache_vocab.stamp[id] == cache_vocab.file_stamp) continue;
+        if (!grow_array((void **)&cache_vocab.words, &cache_vocab.word_capacity, count + 1,
+                        sizeof(str_id_t))) return 0;
+        cache_vocab.stamp[id] = cache_vocab.file_stamp;
+        cache_vocab.index[id] = count;
+        cache_vocab.words[count++] = id;
+    }
+    return count;
+}
+
+void save_cache() {
+    char tmp_path[] = CACHE_FILE ".tmp";
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return;
+    
+    uint32_t version = CACHE_VERSION, count = docs.file_count;
+    fwrite(CACHE_MAGIC, 1, 4, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&count, sizeof(count), 1, f);
+    
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        int64_t mtime = file->mtime, size = file->size;
+        uint64_t inode = file->inode;
+        uint32_t function_count = file->function_count;
+        
+        fwrite(&mtime, sizeof(mtime), 1, f);
+        fwrite(&size, sizeof(size), 1, f);
+        fwrite(&inode, sizeof(inode), 1, f);
+        fwrite(&file->hash, sizeof(file->hash), 1, f);
+        fwrite(&function_count, sizeof(function_count), 1, f);
+        write_cache_string(f, file->filename);
+        
+        uint32_t word_count = collect_cache_vocabulary(file);
+        fwrite(&word_count, sizeof(word_count), 1, f);
+        for (uint32_t k = 0; k < word_count; k++) {
+            write_cache_string(f, cache_vocab.words[k]);
+        }
+        
+        for (int j = 0; j < file->function_count; j++) {
+            function_t *func = &file->functions[j];
+            int32_t line = func->line_number;
+            fwrite(&line, sizeof(line), 1, f);
+            write_cache_string(f, func->name);
+            write_cache_string(f, func->signature);
+            write_cache_string(f, func->return_type);
+            
+            // A file whose vocabulary couldn't be collected saves no bodies
+            uint32_t begin = word_count ? file->body_offsets[j] : 0;
+            uint32_t body_count = word_count ? file->body_offsets[j + 1] - begin : 0;
+            uint32_t call_count = word_count ? file->call_ends[j] - begin : 0;
+            fwrite(&body_count, sizeof(body_count), 1, f);
+            fwrite(&call_count, sizeof(call_count), 1, f);
+            for (uint32_t k = 0; k < body_count; k++) {
+                fwrite(&cache_vocab.index[file->body_words[begin + k]], sizeof(uint32_t), 1, f);
+            }
+        }
+    }
+    
+    if (fclose(f) != 0 || rename(tmp_path, CACHE_FILE) != 0) {
+        unlink(tmp_path);
+    }
+}
+
+// Per-thread table the parser fills before the final, exactly sized copy
+// into the file's arena. Scan workers exit at the end of every scan, so
+// they hand it and the body vocabulary back through free_parse_scratch()
+// first.
+static __thread function_t *parse_scratch;
+static __thread int parse_scratch_capacity;
+
+static void free_parse_scratch() {
+    free(parse_scratch);
+    parse_scratch = NULL;
+    parse_scratch_capacity = 0;
+    free_vocabulary();
+}
+
+// If `cached` describes the same file contents (same stat identity, or
+// failing that the same content hash) its functions are restored from the
+// cache instead of being parsed again. Returns 0 if the record came from
+// the cache unchanged, 1 if the cache entry for it needs rewriting.
+int parse_c_file(const char *filepath, source_file_t *file, const cache_entry_t *cached) {
+    file->function_count = 0;
+    
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return 0;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return 0;
+    }
+    file->mtime = st.st_mtime;
+    file->size = st.st_size;
+    file->inode = st.st_ino;
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    
+    if (cached && cached->mtime == st.st_mtime && cached->size == st.st_size &&
+        cached->inode == st.st_ino) {
+        close(fd);
+        restore_from_cache(cached, file);
+        return 0;
+    }
+    
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    
+    file->hash = hash_bytes(data, st.st_size);
+    if (cached && cached->size == st.st_size && cached->hash == file->hash) {
+        munmap(data, st.st_size);
+        restore_from_cache(cached, file);
+        return 1;
+    }
+    
+    size_t path_len = strlen(filepath);
+    int is_header = path_len > 2 && strcmp(filepath + path_len - 2, ".h") == 0;
+    
+    const char *p = data;
+    const char *end = data + st.st_size;
+    int line_num = 0;
+    
+    int count = 0;
+    reset_vocabulary();
+    while (p < end) {
+        const char *newline = memchr(p, '\n', end - p);
+        const char *line_end = newline ? newline : end;
+        const char *line = p;
+        p = newline ? newline + 1 : end;
+        line_num++;
+        
+        while (line_end > line && isspace((unsigned char)line_end[-1])) line_end--;
+        size_t len = line_end - line;
+        
+        if (!is_function_line(line, len, is_header)) continue;
+        
+        if (!grow_array((void **)&parse_scratch, &parse_scratch_capacity, count + 1,
+                        sizeof(function_t))) break;
+        function_t *func = &parse_scratch[count];
+        
+        // Initialize the entire function structure to zero
+        memset(func, 0, sizeof(function_t));
+        
+        // Extract function name
+        const char *name;
+        size_t name_len;
+        if (!extract_function_name(line, len, &name, &name_len)) continue;
+        
+        func->name = intern_n(name, name_len);
+        func->signature = intern_n(line, len);
+        func->filename = file->filename;
+        func->line_number = line_num;
+        
+        // Only extract return type (parameter parsing removed)
+        char return_type[MAX_NAME_LENGTH];
+        extract_return_type(line, len, return_type);
+        func->return_type = intern(return_type);
+        
+        if (!grow_array((void **)&body_offset_scratch, &body_offset_capacity, count + 2,
+                        sizeof(uint32_t)) ||
+            !grow_array((void **)&call_count_scratch, &call_count_capacity, count + 1,
+                        sizeof(uint32_t))) break;
+        body_offset_scratch[count] = body_scratch_count;
+        call_count_scratch[count] = record_body(line, end, count);
+        
+        count++;
+    }
+    
+    file->functions = arena_alloc(&file->arena, count * sizeof(function_t));
+    if (file->functions) {
+        memcpy(file->functions, parse_scratch, count * sizeof(function_t));
+        file->function_count = count;
+        if (grow_array((void **)&body_offset_scratch, &body_offset_capacity, count + 1, sizeof(uint32_t))) {
+            body_offset_scratch[count] = body_scratch_count;
+            store_bodies(file, count);
+        }
+    }
+    
+    munmap(data, st.st_size);
+    return 1;
+}
+
+// Function lookup index
+//
+// Open-addressing hash map from (file id, function name id) to the
+// function's position in docs.files. Positions shift whenever the file list
+// changes, so every change calls invalidate_indexes() and the map is
+// rebuilt on the next lookup.
+static struct {
+    uint64_t *keys;             // file id << 32 | name id, EMPTY_KEY if unused
+    func_ref_t *values;
+    uint32_t capacity;
+    int valid;
+    uint32_t generation;        // bumped by every invalidate_indexes()
+} func_index;
+
+#define EMPTY_KEY UINT64_MAX
+
+static uint64_t function_key(str_id_t file, str_id_t name) {
+    return (uint64_t)file << 32 | name;
+}
+
+static uint32_t key_slot(uint64_t key, uint32_t capacity) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key & (capacity - 1);
+}
+
+static void build_function_index() {
+    int total = 0;
+    for (int i = 0; i < docs.file_count; i++) {
+        total += docs.files[i]->function_count;
+    }
+    
+    uint32_t capacity = 16;
+    while (capacity < (uint32_t)total * 2) capacity *= 2;
+    
+    if (capacity != func_index.capacity) {
+        free(func_index.keys);
+        free(func_index.values);
+        func_index.keys = malloc(capacity * sizeof(uint64_t));
+        func_index.values = malloc(capacity * sizeof(func_ref_t));
+        func_index.capacity = capacity;
+        if (!func_index.keys || !func_index.values) {
+            free(func_index.keys);
+            free(func_index.values);
+            func_index.keys = NULL;
+            func_index.values = NULL;
+            func_index.capacity = 0;
+            return;
+        }
+    }
+    memset(func_index.keys, 0xff, capacity * sizeof(uint64_t));
+    
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        for (int j = 0; j < file->function_count; j++) {
+            uint64_t key = function_key(file->filename, file->functions[j].name);
+            uint32_t slot = key_slot(key, capacity);
+            while (func_index.keys[slot] != EMPTY_KEY && func_index.keys[slot] != key) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            // Keep the first definition when a name repeats within a file
+            if (func_index.keys[slot] == EMPTY_KEY) {
+                func_index.keys[slot] = key;
+                func_index.values[slot] = (func_ref_t){ i, j };
+            }
+        }
+    }
+    func_index.valid = 1;
+}
+
+function_t *find_function(str_id_t file, str_id_t name) {
+    if (!func_index.valid) build_function_index();
+    if (!func_index.capacity) return NULL;
+    
+    uint64_t key = function_key(file, name);
+    for (uint32_t slot = key_slot(key, func_index.capacity); func_index.keys[slot] != EMPTY_KEY;
+         slot = (slot + 1) & (func_index.capacity - 1)) {
+        if (func_index.keys[slot] == key) {
+            func_ref_t ref = func_index.values[slot];
+            return &docs.files[ref.file]->functions[ref.func];
+        }
+    }
+    return NULL;
+}
+
+// Search index
+//
+// Trigram index over function names, signatures and descriptions, giving
+// substring search without scanning every function. Characters are folded
+// to 6 bits first (case-insensitive letters, digits and '_' keep their own
+// code; other punctuation shares a few), so a trigram is an 18-bit key and
+// lists are found by direct lookup. Functions are numbered by ordinal
+// (position across docs.files, in order), so each posting list is a sorted
+// array of ordinals. A query intersects the lists of its trigrams and then
+// verifies the few candidates with a real substring check, which also
+// discards collisions from the folding. Like the function index it is
+// rebuilt lazily after invalidate_indexes(), in two steps: the ordinal
+// table first (cheap, and all the fuzzy finder needs), the posting lists
+// on the first substring search. Description edits are applied in place
+// by reindex_function().
+#define TRIGRAM_KEYS (1 << 18)
+
+typedef struct {
+    uint32_t *ordinals;
+    uint32_t count;
+    int capacity;
+} posting_list_t;
+
+typedef struct {
+    uint32_t *keys;
+    int count;
+    int capacity;
+} trigram_set_t;
+
+static struct {
+    func_ref_t *refs;           // ordinal -> position in docs.files
+    int ref_capacity;
+    uint64_t *name_masks;       // ordinal -> folded characters of the name
+    int name_mask_capacity;
+    char *names;                // every name in ordinal order, NUL-separated,
+    int names_capacity;         // so the fuzzy finder reads them sequentially
+    uint32_t *name_offsets;     // ordinal -> start in names, plus an end marker
+    int name_offset_capacity;
+    uint32_t function_count;
+    uint32_t *file_base;        // ordinal of each file's first function
+    int file_base_capacity;
+    uint64_t *file_masks;       // folded characters of each path, plus "::"
+    int file_mask_capacity;
+    uint64_t *documented;       // bit per ordinal, set if documented
+    int documented_capacity;
+    uint32_t *list_of;          // trigram -> index into lists + 1, 0 if none
+    posting_list_t *lists;
+    int list_count;
+    int list_capacity;
+    int valid;                  // ordinals and masks
+    int trigrams_valid;         // posting lists
+    uint32_t generation;        // bumped whenever the posting lists change
+} search_index;
+
+static uint8_t fold_table[256];
+
+static void init_fold_table() {
+    for (int c = 0; c < 256; c++) {
+        if (isalpha(c)) fold_table[c] = tolower(c) - 'a' + 1;   // 1..26
+        else if (isdigit(c)) fold_table[c] = c - '0' + 27;      // 27..36
+        else if (c == '_') fold_table[c] = 37;
+        else if (isspace(c)) fold_table[c] = 0;
+        else fold_table[c] = 38 + c % 26;                       // 38..63, shared
+    }
+}
+
+static inline uint32_t fold_char(unsigned char c) {
+    return fold_table[c];
+}
+
+// Bit per folded character present in `text`, for the fuzzy finder
+static uint64_t char_mask(const char *text) {
+    uint64_t mask = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        mask |= 1ULL << fold_char(*p);
+    }
+    return mask;
+}
+
+static void add_trigrams(const char *text, trigram_set_t *set) {
+    size_t len = strlen(text);
+    if (len < 3) return;
+    if (!grow_array((void **)&set->keys, &set->capacity, set->count + len - 2, sizeof(uint32_t))) return;
+    
+    const unsigned char *p = (const unsigned char *)text;
+    uint32_t key = fold_char(p[0]) << 6 | fold_char(p[1]);
+    for (size_t i = 2; i < len; i++) {
+        key = (key << 6 | fold_char(p[i])) & (TRIGRAM_KEYS - 1);
+        set->keys[set->count++] = key;
+    }
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void sort_unique_keys(trigram_set_t *set) {
+    qsort(set->keys, set->count, sizeof(uint32_t), compare_keys);
+    int unique = 0;
+    for (int i = 0; i < set->count; i++) {
+        if (unique == 0 || set->keys[i] != set->keys[unique - 1]) set->keys[unique++] = set->keys[i];
+    }
+    set->count = unique;
+}
+
+// The distinct trigrams of a function, sorted
+static void collect_trigrams(const function_t *func, const char *description, trigram_set_t *set) {
+    set->count = 0;
+    add_trigrams(str(func->name), set);
+    add_trigrams(str(func->signature), set);
+    add_trigrams(description, set);
+    sort_unique_keys(set);
+}
+
+static posting_list_t *posting_list(uint32_t key, int create) {
+    if (search_index.list_of && search_index.list_of[key]) {
+        return &search_index.lists[search_index.list_of[key] - 1];
+    }
+    if (!create) return NULL;
+    
+    if (!search_index.list_of) {
+        search_index.list_of = calloc(TRIGRAM_KEYS, sizeof(uint32_t));
+        if (!search_index.list_of) return NULL;
+    }
+    if (!grow_array((void **)&search_index.lists, &search_index.list_capacity,
+                    search_index.list_count + 1, sizeof(posting_list_t))) return NULL;
+    
+    posting_list_t *list = &search_index.lists[search_index.list_count++];
+    memset(list, 0, sizeof(*list));
+    search_index.list_of[key] = search_index.list_count;
+    return list;
+}
+
+// First position in `list` at or after `from` holding an ordinal >= target.
+// Gallops forward first: intersections mostly seek a short distance.
+static uint32_t posting_seek(const posting_list_t *list, uint32_t from, uint32_t target) {
+    uint32_t lo = from, hi = list->count, step = 1;
+    while (lo + step < hi && list->ordinals[lo + step] < target) {
+        lo += step;
+        step *= 2;
+    }
+    if (lo + step < hi) hi = lo + step + 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (list->ordinals[mid] < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void posting_insert(posting_list_t *list, uint32_t ordinal) {
+    uint32_t pos = posting_seek(list, 0, ordinal);
+    if (pos < list->count && list->ordinals[pos] == ordinal) return;
+    if (!grow_array((void **)&list->ordinals, &list->capacity, list->count + 1, sizeof(uint32_t))) return;
+    memmove(list->ordinals + pos + 1, list->ordinals + pos, (list->count - pos) * sizeof(uint32_t));
+    list->ordinals[pos] = ordinal;
+    list->count++;
+}
+
+static void posting_remove(posting_list_t *list, uint32_t ordinal) {
+    uint32_t pos = posting_seek(list, 0, ordinal);
+    if (pos == list->count || list->ordinals[pos] != ordinal) return;
+    memmove(list->ordinals + pos, list->ordinals + pos + 1, (list->count - pos - 1) * sizeof(uint32_t));
+    list->count--;
+}
+
+static trigram_set_t index_trigrams;
+
+// Number the functions; this much is all the fuzzy finder needs
+static void build_ordinals() {
+    if (!fold_table['a']) init_fold_table();
+    
+    if (!grow_array((void **)&search_index.file_base, &search_index.file_base_capacity,
+                    docs.file_count + 1, sizeof(uint32_t)) ||
+        !grow_array((void **)&search_index.file_masks, &search_index.file_mask_capacity,
+                    docs.file_count, sizeof(uint64_t))) return;
+    
+    uint32_t total = 0;
+    for (int i = 0; i < docs.file_count; i++) total += docs.files[i]->function_count;
+    if (!grow_array((void **)&search_index.documented, &search_index.documented_capacity,
+                    total / 64 + 1, sizeof(uint64_t))) return;
+    memset(search_index.documented, 0, (total / 64 + 1) * sizeof(uint64_t));
+    
+    uint32_t ordinal = 0, names_size = 0;
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        search_index.file_base[i] = ordinal;
+        search_index.file_masks[i] = char_mask(str(file->filename)) | char_mask("::");
+        if (!grow_array((void **)&search_index.refs, &search_index.ref_capacity,
+                        ordinal + file->function_count, sizeof(func_ref_t)) ||
+            !grow_array((void **)&search_index.name_masks, &search_index.name_mask_capacity,
+                        ordinal + file->function_count, sizeof(uint64_t)) ||
+            !grow_array((void **)&search_index.name_offsets, &search_index.name_offset_capacity,
+                        ordinal + file->function_count + 1, sizeof(uint32_t))) return;
+        
+        for (int j = 0; j < file->function_count; j++, ordinal++) {
+            const char *name = str(file->functions[j].name);
+            size_t len = strlen(name) + 1;
+            if (!grow_array((void **)&search_index.names, &search_index.names_capacity,
+                            names_size + len, 1)) return;
+            memcpy(search_index.names + names_size, name, len);
+            search_index.name_offsets[ordinal] = names_size;
+            names_size += len;
+            
+            search_index.refs[ordinal] = (func_ref_t){ i, j };
+            search_index.name_masks[ordinal] = char_mask(name);
+            if (file->functions[j].is_documented) {
+                search_index.documented[ordinal / 64] |= 1ULL << (ordinal % 64);
+            }
+        }
+    }
+    search_index.name_offsets[ordinal] = names_size;
+    search_index.file_base[docs.file_count] = ordinal;
+    search_index.function_count = ordinal;
+    search_index.valid = 1;
+}
+
+static void build_trigrams() {
+    if (!search_index.valid) build_ordinals();
+    if (!search_index.valid) return;
+    
+    // Lists are emptied and reused rather than freed
+    for (int i = 0; i < search_index.list_count; i++) {
+        search_index.lists[i].count = 0;
+    }
+    
+    // Ordinals only increase, so appending keeps every list sorted, and a
+    // repeated trigram within one function shows up as the list's last entry
+    trigram_set_t *trigrams = &index_trigrams;
+    for (uint32_t ordinal = 0; ordinal < search_index.function_count; ordinal++) {
+        func_ref_t ref = search_index.refs[ordinal];
+        function_t *func = &docs.files[ref.file]->functions[ref.func];
+        
+        trigrams->count = 0;
+        add_trigrams(str(func->name), trigrams);
+        add_trigrams(str(func->signature), trigrams);
+        add_trigrams(get_docs(func)->description, trigrams);
+        
+        for (int k = 0; k < trigrams->count; k++) {
+            posting_list_t *list = posting_list(trigrams->keys[k], 1);
+            if (!list || (list->count > 0 && list->ordinals[list->count - 1] == ordinal)) continue;
+            if (!grow_array((void **)&list->ordinals, &list->capacity,
+                            list->count + 1, sizeof(uint32_t))) continue;
+            list->ordinals[list->count++] = ordinal;
+        }
+    }
+    search_index.trigrams_valid = 1;
+    search_index.generation++;
+}
+
+// Bring the index up to date after func's description changed from
+// `old_description`
+void reindex_function(const function_t *func, const char *old_description) {
+    if (!search_index.valid) return;  // the next search rebuilds it anyway
+    
+    int file_idx = find_file_index(str(func->filename));
+    if (file_idx < 0) return;
+    uint32_t ordinal = search_index.file_base[file_idx] + (func - docs.files[file_idx]->functions);
+    if (func->is_documented) search_index.documented[ordinal / 64] |= 1ULL << (ordinal % 64);
+    if (!search_index.trigrams_valid) return;
+    
+    trigram_set_t old_trigrams = { 0 };
+    collect_trigrams(func, old_description, &old_trigrams);
+    collect_trigrams(func, get_docs(func)->description, &index_trigrams);
+    
+    // Both sets are sorted: walk them together
+    int i = 0, j = 0;
+    while (i < old_trigrams.count || j < index_trigrams.count) {
+        if (j == index_trigrams.count ||
+            (i < old_trigrams.count && old_trigrams.keys[i] < index_trigrams.keys[j])) {
+            posting_list_t *list = posting_list(old_trigrams.keys[i++], 0);
+            if (list) posting_remove(list, ordinal);
+        } else if (i == old_trigrams.count || index_trigrams.keys[j] < old_trigrams.keys[i]) {
+            posting_list_t *list = posting_list(index_trigrams.keys[j++], 1);
+            if (list) posting_insert(list, ordinal);
+        } else {
+            i++;
+            j++;
+        }
+    }
+    free(old_trigrams.keys);
+    search_index.generation++;
+}
+
+// Background indexes
+//
+// The body index and the name order are built from docs.files alone, on a
+// background thread started while the main loop waits for keys. Any change
+// to the file list stops the thread first, since it reads docs.files.
+static struct {
+    pthread_t thread;
+    int running;                // started and not yet joined
+    int cancel;
+} background;
+
+static int background_cancelled() {
+    return __atomic_load_n(&background.cancel, __ATOMIC_RELAXED);
+}
+
+// Body index
+//
+// For each identifier, the ordinals of the functions whose bodies use it,
+// built from the words recorded at parse time (and kept in the parse
+// cache), so no file is read again. Built into one array, list after list:
+// a first pass counts the uses of each word, a second fills the lists in
+// ordinal order so each comes out sorted. Until it is ready, body: terms
+// are checked function by function.
+static struct {
+    int ready;                  // set by the builder once the lists are complete
+    uint32_t word_count;        // string ids covered: strings.count at the start
+    uint32_t *starts;           // string id -> first entry in ordinals, plus an end marker
+    int starts_capacity;
+    uint32_t *ordinals;
+    int ordinals_capacity;
+} body_index;
+
+static int build_body_index() {
+    uint32_t words = body_index.word_count;
+    if (!grow_array((void **)&body_index.starts, &body_index.starts_capacity, words + 1,
+                    sizeof(uint32_t))) return 0;
+    memset(body_index.starts, 0, (words + 1) * sizeof(uint32_t));
+    
+    // Count into starts[id + 1], so the prefix sum leaves starts[id] at the list's beginning
+    uint32_t total = 0;
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        if (!file->body_offsets) continue;
+        uint32_t end = file->body_offsets[file->function_count];
+        for (uint32_t k = 0; k < end; k++) body_index.starts[file->body_words[k] + 1]++;
+        total += end;
+        if (background_cancelled()) return 0;
+    }
+    for (uint32_t id = 0; id < words; id++) body_index.starts[id + 1] += body_index.starts[id];
+    if (!grow_array((void **)&body_index.ordinals, &body_index.ordinals_capacity,
+                    total ? total : 1, sizeof(uint32_t))) return 0;
+    
+    // Fill, advancing starts[id] past each entry; it ends up at the next list's beginning
+    uint32_t ordinal = 0;
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        for (int j = 0; j < file->function_count; j++, ordinal++) {
+            if (!file->body_offsets) continue;
+            for (uint32_t k = file->body_offsets[j]; k < file->body_offsets[j + 1]; k++) {
+                body_index.ordinals[body_index.starts[file->body_words[k]]++] = ordinal;
+            }
+        }
+        if (background_cancelled()) return 0;
+    }
+    memmove(body_index.starts + 1, body_index.starts, words * sizeof(uint32_t));
+    body_index.starts[0] = 0;
+    
+    __atomic_store_n(&body_index.ready, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// The functions using identifier `id` in their bodies, if the index is ready
+static int body_list(str_id_t id, posting_list_t *list) {
+    if (!__atomic_load_n(&body_index.ready, __ATOMIC_ACQUIRE)) return 0;
+    if (id >= body_index.word_count) {
+        *list = (posting_list_t){ NULL, 0, 0 };
+    } else {
+        uint32_t start = body_index.starts[id];
+        *list = (posting_list_t){ body_index.ordinals + start, body_index.starts[id + 1] - start, 0 };
+    }
+    return 1;
+}
+
+// Whether function j of `file` uses identifier `id` in its body
+static int body_uses(const source_file_t *file, int j, str_id_t id) {
+    if (!file->body_offsets) return 0;
+    for (uint32_t k = file->body_offsets[j]; k < file->body_offsets[j + 1]; k++) {
+        if (file->body_words[k] == id) return 1;
+    }
+    return 0;
+}
+
+// Name order
+//
+// Every ordinal sorted by function name, for exact lookups and prefix
+// completion by binary search. Names that share a prefix are adjacent, so
+// a prefix's matches are one range and its completion is the common
+// prefix of the range's first and last names. Sorting compares the first
+// 16 bytes as two big-endian numbers, so most comparisons never touch the
+// names themselves.
+static struct {
+    int ready;
+    uint32_t *ordinals;
+    int capacity;
+} name_order;
+
+typedef struct {
+    uint64_t prefix[2];
+    const char *name;
+    uint32_t ordinal;
+} name_key_t;
+
+static int compare_name_keys(const void *a, const void *b) {
+    const name_key_t *x = a, *y = b;
+    if (x->prefix[0] != y->prefix[0]) return x->prefix[0] < y->prefix[0] ? -1 : 1;
+    if (x->prefix[1] != y->prefix[1]) return x->prefix[1] < y->prefix[1] ? -1 : 1;
+    int cmp = strcmp(x->name, y->name);
+    return cmp ? cmp : (x->ordinal > y->ordinal) - (x->ordinal < y->ordinal);
+}
+
+static int build_name_order() {
+    uint32_t count = 0;
+    for (int i = 0; i < docs.file_count; i++) count += docs.files[i]->function_count;
+    
+    name_key_t *keys = malloc((count ? count : 1) * sizeof(name_key_t));
+    if (!keys || !grow_array((void **)&name_order.ordinals, &name_order.capacity, count ? count : 1,
+                             sizeof(uint32_t))) {
+        free(keys);
+        return 0;
+    }
+    
+    uint32_t ordinal = 0;
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        for (int j = 0; j < file->function_count; j++, ordinal++) {
+            // Bytes past the end of the name stay zero, like the terminator
+            const char *name = str(file->functions[j].name);
+            name_key_t *key = &keys[ordinal];
+            *key = (name_key_t){ { 0, 0 }, name, ordinal };
+            for (int k = 0; k < 16 && name[k]; k++) {
+                key->prefix[k / 8] |= (uint64_t)(unsigned char)name[k] << (56 - 8 * (k % 8));
+            }
+        }
+    }
+    if (background_cancelled()) {
+        free(keys);
+        return 0;
+    }
+    
+    qsort(keys, count, sizeof(name_key_t), compare_name_keys);
+    for (uint32_t i = 0; i < count; i++) name_order.ordinals[i] = keys[i].ordinal;
+    free(keys);
+    
+    __atomic_store_n(&name_order.ready, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void *build_background_indexes(void *arg) {
+    (void)arg;
+    if (!body_index.ready && !build_body_index()) return NULL;
+    if (!name_order.ready) build_name_order();
+    return NULL;
+}
+
+// Start building the background indexes unless they are built or being built
+void ensure_background_indexes() {
+    if (background.running || (body_index.ready && name_order.ready)) return;
+    
+    if (!body_index.ready) body_index.word_count = strings.count;
+    background.cancel = 0;
+    if (pthread_create(&background.thread, NULL, build_background_indexes, NULL) == 0) {
+        background.running = 1;
+    } else {
+        build_background_indexes(NULL);
+    }
+}
+
+static void finish_background_indexes() {
+    if (background.running) {
+        pthread_join(background.thread, NULL);
+        background.running = 0;
+    }
+}
+
+static void stop_background_indexes() {
+    __atomic_store_n(&background.cancel, 1, __ATOMIC_RELAXED);
+    finish_background_indexes();
+    background.cancel = 0;
+    body_index.ready = 0;
+    name_order.ready = 0;
+}
+
+static inline const char *ordinal_name(uint32_t ordinal) {
+    return search_index.names + search_index.name_offsets[ordinal];
+}
+
+// First position in name order whose name, cut to `len` characters,
+// compares above `key` (`upper`) or at least equal to it
+static uint32_t name_bound(const char *key, size_t len, int upper) {
+    uint32_t lo = 0, hi = search_index.function_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strncmp(ordinal_name(name_order.ordinals[mid]), key, len);
+        if (cmp < 0 || (upper && cmp == 0)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// The range of name order holding functions whose name starts with
+// `prefix`, or is exactly `prefix` with `exact`. Returns 0 if the order
+// couldn't be built.
+int find_names(const char *prefix, int exact, uint32_t *first, uint32_t *last) {
+    if (!search_index.valid) build_ordinals();
+    if (!search_index.valid) return 0;
+    if (!name_order.ready) {
+        // Usually it is being built already; otherwise build it here
+        finish_background_indexes();
+        if (!name_order.ready && !build_name_order()) return 0;
+    }
+    
+    // Comparing the terminator too makes the prefix match exact
+    size_t len = strlen(prefix) + (exact ? 1 : 0);
+    *first = name_bound(prefix, len, 0);
+    *last = name_bound(prefix, len, 1);
+    return 1;
+}
+
+void invalidate_search_index() {
+    search_index.valid = 0;
+    search_index.trigrams_valid = 0;
+}
+
+void invalidate_indexes() {
+    func_index.valid = 0;
+    func_index.generation++;
+    invalidate_search_index();
+    stop_background_indexes();
+}
+
+// Cross references
+//
+// A call is an identifier followed by '(' in a body. Calls are recorded
+// per function while parsing, so per file, in parallel and only for files
+// that changed, and kept in the parse cache. They are resolved by name: to
+// the definition in the caller's own file if there is one (a static
+// function shadows the others), otherwise to every definition. Callers
+// come from the body index, narrowed to the functions whose calls include
+// the name; before the index is ready every function's calls are checked.
+static int function_calls(const source_file_t *file, int j, str_id_t id) {
+    if (!file->body_offsets) return 0;
+    for (uint32_t k = file->body_offsets[j]; k < file->call_ends[j]; k++) {
+        if (file->body_words[k] == id) return 1;
+    }
+    return 0;
+}
+
+static void add_search_result(func_ref_t ref) {
+    if (!grow_array((void **)&docs.search_results, &docs.search_capacity, docs.search_count + 1,
+                    sizeof(func_ref_t))) return;
+    docs.search_results[docs.search_count++] = ref;
+}
+
+// Whether a call from `caller_file` to `name` reaches func
+static int call_reaches(str_id_t caller_file, str_id_t name, const function_t *func) {
+    if (caller_file == func->filename) return 1;
+    return !find_function(caller_file, name);
+}
+
+// A signature ending in ';' is a header prototype rather than a definition
+static int is_prototype(const function_t *func) {
+    const char *signature = str(func->signature);
+    size_t len = strlen(signature);
+    return len > 0 && signature[len - 1] == ';';
+}
+
+// The functions func calls, in the order of their first call, as search
+// results. A name defined somewhere lists only its definitions, and a file
+// holding several entries for the name (a prototype and its definition, or
+// #ifdef alternatives) lists one of them.
+void find_callees(const function_t *func) {
+    docs.search_count = 0;
+    int file_idx = find_file_index(str(func->filename));
+    if (file_idx < 0) return;
+    source_file_t *file = docs.files[file_idx];
+    int j = func - file->functions;
+    if (!file->body_offsets) return;
+    
+    for (uint32_t k = file->body_offsets[j]; k < file->call_ends[j]; k++) {
+        str_id_t name = file->body_words[k];
+        function_t *local = find_function(func->filename, name);
+        if (local) {
+            add_search_result((func_ref_t){ file_idx, local - file->functions });
+            continue;
+        }
+        
+        uint32_t first, last;
+        if (!find_names(str(name), 1, &first, &last)) return;
+        int defined = 0;
+        for (uint32_t i = first; i < last && !defined; i++) {
+            func_ref_t ref = search_index.refs[name_order.ordinals[i]];
+            defined = !is_prototype(&docs.files[ref.file]->functions[ref.func]);
+        }
+        
+        int start = docs.search_count;
+        for (uint32_t i = first; i < last; i++) {
+            func_ref_t ref = search_index.refs[name_order.ordinals[i]];
+            if (defined && is_prototype(&docs.files[ref.file]->functions[ref.func])) continue;
+            int listed = 0;
+            for (int r = start; r < docs.search_count && !listed; r++) {
+                listed = docs.search_results[r].file == ref.file;
+            }
+            if (!listed) add_search_result(ref);
+        }
+    }
+}
+
+// The project functions a function calls, resolved for the detail view
+#define SHOWN_CALLEES 8
+
+static struct {
+    const source_file_t *file;  // whose function `func` they are, NULL if none
+    int func;
+    uint32_t generation;        // func_index.generation they were resolved in
+    str_id_t shown[SHOWN_CALLEES];
+    int shown_count;
+    int total;
+} callee_names;
+
+// The names function j of `file` calls that belong to the project; the
+// rest are library functions and macros. Resolved once per function and
+// kept until the indexes change, rather than looked up on every redraw.
+static void resolve_callee_names(const source_file_t *file, int j) {
+    if (callee_names.file == file && callee_names.func == j &&
+        callee_names.generation == func_index.generation) return;
+    
+    callee_names.shown_count = callee_names.total = 0;
+    for (uint32_t k = file->body_offsets ? file->body_offsets[j] : 0;
+         file->body_offsets && k < file->call_ends[j]; k++) {
+        uint32_t first, last;
+        str_id_t name = file->body_words[k];
+        if (!find_function(file->filename, name) &&
+            (!find_names(str(name), 1, &first, &last) || first == last)) continue;
+        if (callee_names.shown_count < SHOWN_CALLEES) callee_names.shown[callee_names.shown_count++] = name;
+        callee_names.total++;
+    }
+    callee_names.file = file;
+    callee_names.func = j;
+    callee_names.generation = func_index.generation;
+}
+
+// The functions calling func, in file order, as search results
+void find_callers(const function_t *func) {
+    docs.search_count = 0;
+    if (!search_index.valid) build_ordinals();
+    if (!search_index.valid) return;
+    
+    posting_list_t list;
+    if (body_list(func->name, &list)) {
+        for (uint32_t i = 0; i < list.count; i++) {
+            func_ref_t ref = search_index.refs[list.ordinals[i]];
+            source_file_t *file = docs.files[ref.file];
+            if (function_calls(file, ref.func, func->name) &&
+                call_reaches(file->filename, func->name, func)) add_search_result(ref);
+        }
+        return;
+    }
+    
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        for (int j = 0; j < file->function_count; j++) {
+            if (function_calls(file, j, func->name) && call_reaches(file->filename, func->name, func)) {
+                add_search_result((func_ref_t){ i, j });
+            }
+        }
+    }
+}
+
+// Parallel project scanner
+//
+// Directories and source files are both work items. Workers pop items off a
+// shared stack: a directory is read and its entries pushed back as new items,
+// a source file is parsed into a heap-allocated record. An idle worker simply
+// takes whatever another worker pushed last, so one huge directory or a deep
+// subtree doesn't pin the whole scan to a single thread.
+//
+// The scan runs in the background while the UI is up. Files that are new or
+// changed are queued as updates and swapped into docs.files by the main
+// loop every SCAN_REFRESH_MS, so the list fills in as the scan goes; files
+// that didn't change are only noted as seen. Workers find previous records
+// in a snapshot of the file list taken when the scan started, and records
+// replaced meanwhile are retired rather than freed until it ends.
+typedef struct scan_item {
+    char *path;
+    int is_dir;
+    struct scan_item *next;
+} scan_item_t;
+
+// Stat identity of a source file without functions. Such files aren't
+// listed, so this is what lets a rescan skip them when they're unchanged.
+typedef struct {
+    str_id_t path;
+    time_t mtime;
+    off_t size;
+    ino_t inode;
+} file_stamp_t;
+
+// A parsed file on its way into docs.files, from the scanner or the watcher
+typedef struct file_update {
+    char *path;
+    source_file_t *file;        // NULL if the file is gone or has no functions
+    struct file_update *next;
+} file_update_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int threaded;               // `thread` runs the scan and has to be joined
+    int running;                // started and not finished by the main loop yet
+    int done;                   // the workers are through, see finish_scan()
+    int cancel;
+    scan_item_t *stack;
+    int pending;                // items pushed but not yet finished
+    int parsed;                 // source files read so far
+    file_update_t *updates;     // new or changed files not in docs.files yet
+    str_id_t *seen;             // paths of every source file with functions
+    int seen_count;
+    int seen_capacity;
+    source_file_t **previous;   // docs.files when the scan started
+    int previous_count;
+    int previous_capacity;
+    source_file_t **retired;    // replaced during the scan, freed when it ends
+    int retired_count;
+    int retired_capacity;
+    int new_files;              // files added to docs.files by this scan
+    int changed_files;          // files that differ from the parse cache
+    int cached_count;           // files the parse cache had
+    int cancelled;              // the last scan was cancelled, so the list may be partial
+    int rescan_pending;         // the watcher asked for a rescan while one was running
+    file_stamp_t *empty;        // files without functions at the last full scan, sorted
+    int empty_count;
+    int empty_capacity;
+    file_stamp_t *found_empty;  // the same for this scan, sorted once it is done
+    int found_empty_count;
+    int found_empty_capacity;
+    char **dirs;                // directories read by the last scan
+    int dir_count;
+    int dir_capacity;
+} scan = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+// Worker threads write a byte here to wake the main loop
+static int wake_pipe[2] = { -1, -1 };
+
+static void wake_main_loop() {
+    if (write(wake_pipe[1], "w", 1) < 0) {
+        // Pipe already full: the main loop has a wakeup pending anyway
+    }
+}
+
+// Caller must hold scan.lock
+static void scan_push(char *path, int is_dir) {
+    scan_item_t *item = malloc(sizeof(scan_item_t));
+    if (!item) {
+        free(path);
+        return;
+    }
+    item->path = path;
+    item->is_dir = is_dir;
+    item->next = scan.stack;
+    scan.stack = item;
+    scan.pending++;
+    pthread_cond_signal(&scan.cond);
+}
+
+static char *join_path(const char *dir, const char *name) {
+    // Keep paths relative to the project root without a leading "./"
+    if (strcmp(dir, ".") == 0) return strdup(name);
+    
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char *path = malloc(len);
+    if (path) snprintf(path, len, "%s/%s", dir, name);
+    return path;
+}
+
+// Caller must hold scan.lock
+static void scan_add_dir(const char *dirpath) {
+    if (!grow_array((void **)&scan.dirs, &scan.dir_capacity, scan.dir_count + 1,
+                    sizeof(char *))) return;
+    char *copy = strdup(dirpath);
+    if (copy) scan.dirs[scan.dir_count++] = copy;
+}
+
+static void scan_directory(const char *dirpath) {
+    DIR *dir = opendir(dirpath);
+    if (!dir) return;
+    
+    pthread_mutex_lock(&scan.lock);
+    scan_add_dir(dirpath);
+    pthread_mutex_unlock(&scan.lock);
+    
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // Skip ".", ".." and hidden directories such as .git
+        if (entry->d_name[0] == '.' && entry->d_type != DT_REG) continue;
+        
+        int is_dir = 0;
+        if (entry->d_type == DT_DIR) {
+            is_dir = 1;
+        } else if (entry->d_type != DT_REG) {
+            // DT_UNKNOWN or a symlink: only follow links to regular files so
+            // directory cycles can't trap the scan
+            char *path = join_path(dirpath, entry->d_name);
+            struct stat st;
+            int ok = path && stat(path, &st) == 0;
+            free(path);
+            if (!ok) continue;
+            if (S_ISDIR(st.st_mode)) {
+                if (entry->d_type == DT_LNK) continue;
+                is_dir = 1;
+            } else if (!S_ISREG(st.st_mode)) {
+                continue;
+            }
+        }
+        
+        if (!is_dir && !is_c_file(entry->d_name)) continue;
+        
+        char *path = join_path(dirpath, entry->d_name);
+        if (!path) continue;
+        
+        pthread_mutex_lock(&scan.lock);
+        scan_push(path, is_dir);
+        pthread_mutex_unlock(&scan.lock);
+    }
+    
+    closedir(dir);
+}
+
+// Caller must hold scan.lock
+static void scan_add_seen(str_id_t path) {
+    if (!grow_array((void **)&scan.seen, &scan.seen_capacity, scan.seen_count + 1,
+                    sizeof(str_id_t))) return;
+    scan.seen[scan.seen_count++] = path;
+}
+
+// Returns the index of `path` in `files` (count records sorted by path), or
+// -(insertion point) - 1 if it isn't there
+static int search_files(source_file_t **files, int count, const char *path) {
+    int lo = 0, hi = count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(str(files[mid]->filename), path);
+        if (cmp == 0) return mid;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+// docs.files is kept sorted by path; main thread only
+static int find_file_index(const char *path) {
+    return search_files(docs.files, docs.file_count, path);
+}
+
+// The snapshot doesn't change while the scan runs, so workers read it
+// without locking
+static source_file_t *find_previous_file(const char *path) {
+    int index = search_files(scan.previous, scan.previous_count, path);
+    return index >= 0 ? scan.previous[index] : NULL;
+}
+
+// Coverage counts are kept as functions get documented and files come and
+// go, so views and exports read them instead of walking every function.
+coverage_t file_coverage(const source_file_t *file) {
+    return (coverage_t){ file->function_count, file->documented_count };
+}
+
+coverage_t project_coverage() {
+    return docs.coverage;
+}
+
+float coverage_percent(coverage_t coverage) {
+    return coverage.functions > 0 ? (float)coverage.documented / coverage.functions * 100 : 0;
+}
+
+// Add (sign 1) or remove (sign -1) a file in docs.files from the totals
+static void count_coverage(const source_file_t *file, int sign) {
+    docs.coverage.functions += sign * file->function_count;
+    docs.coverage.documented += sign * file->documented_count;
+}
+
+// Mark a function of a file in docs.files as documented
+void set_documented(function_t *func) {
+    if (func->is_documented) return;
+    func->is_documented = 1;
+    int index = find_file_index(str(func->filename));
+    if (index < 0) return;
+    docs.files[index]->documented_count++;
+    docs.coverage.documented++;
+}
+
+// Keep documentation for functions that survived an edit of their file. The
+// documentation records move to the new file; `old` is about to be freed.
+static void carry_over_documentation(source_file_t *old, source_file_t *file) {
+    // Only documented functions matter, and there are usually few of them
+    function_t **documented = malloc((old->function_count + 1) * sizeof(function_t *));
+    if (!documented) return;
+    int documented_count = 0;
+    for (int j = 0; j < old->function_count; j++) {
+        if (old->functions[j].is_documented) documented[documented_count++] = &old->functions[j];
+    }
+    
+    for (int i = 0; i < file->function_count && documented_count > 0; i++) {
+        function_t *func = &file->functions[i];
+        for (int j = 0; j < documented_count; j++) {
+            function_t *prev = documented[j];
+            if (prev->name == func->name) {
+                // Not listed yet, so only the file counts it
+                func->docs = prev->docs;
+                func->is_documented = 1;
+                file->documented_count++;
+                prev->docs = NULL;
+                documented[j] = documented[--documented_count];
+                break;
+            }
+        }
+    }
+    
+    free(documented);
+}
+
+// The last scan's stamp for `path`, if it had no functions then
+static const file_stamp_t *find_empty_file(const char *path) {
+    int lo = 0, hi = scan.empty_count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(path, str(scan.empty[mid].path));
+        if (cmp == 0) return &scan.empty[mid];
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+static void scan_add_empty(file_stamp_t stamp) {
+    pthread_mutex_lock(&scan.lock);
+    if (grow_array((void **)&scan.found_empty, &scan.found_empty_capacity, scan.found_empty_count + 1,
+                   sizeof(file_stamp_t))) {
+        scan.found_empty[scan.found_empty_count++] = stamp;
+    }
+    pthread_mutex_unlock(&scan.lock);
+}
+
+static void scan_parse_file(const char *path) {
+    source_file_t *previous = find_previous_file(path);
+    const file_stamp_t *empty = previous ? NULL : find_empty_file(path);
+    __atomic_add_fetch(&scan.parsed, 1, __ATOMIC_RELAXED);
+    
+    struct stat st;
+    int stated = (previous || empty) && stat(path, &st) == 0;
+    if (stated && previous && st.st_mtime == previous->mtime && st.st_size == previous->size &&
+        st.st_ino == previous->inode) {
+        pthread_mutex_lock(&scan.lock);
+        scan_add_seen(previous->filename);
+        pthread_mutex_unlock(&scan.lock);
+        return;
+    }
+    // Still the contents that had no functions last time
+    if (stated && empty && st.st_mtime == empty->mtime && st.st_size == empty->size &&
+        st.st_ino == empty->inode) {
+        scan_add_empty(*empty);
+        return;
+    }
+    
+    source_file_t *file = new_source_file(path);
+    if (!file) return;
+    
+    if (parse_c_file(path, file, previous ? NULL : find_cache_entry(path))) {
+        __atomic_add_fetch(&scan.changed_files, 1, __ATOMIC_RELAXED);
+    }
+    
+    // Files without functions aren't listed; finish_scan() drops the old
+    // record. Their identity is kept so the next scan can skip them.
+    if (file->function_count == 0) {
+        if (file->inode) {
+            scan_add_empty((file_stamp_t){ file->filename, file->mtime, file->size, file->inode });
+        }
+        free_source_file(file);
+        return;
+    }
+    
+    // Documentation is carried over when the main loop applies the update
+    file_update_t *update = calloc(1, sizeof(file_update_t));
+    if (update) update->path = strdup(path);
+    if (!update || !update->path) {
+        free(update);
+        free_source_file(file);
+        return;
+    }
+    update->file = file;
+    
+    pthread_mutex_lock(&scan.lock);
+    scan_add_seen(file->filename);
+    update->next = scan.updates;
+    scan.updates = update;
+    pthread_mutex_unlock(&scan.lock);
+}
+
+static void *scan_worker(void *arg) {
+    (void)arg;
+    
+    pthread_mutex_lock(&scan.lock);
+    while (1) {
+        while (!scan.stack && scan.pending > 0) {
+            pthread_cond_wait(&scan.cond, &scan.lock);
+        }
+        if (!scan.stack) break;  // nothing queued and nothing in flight
+        
+        scan_item_t *item = scan.stack;
+        scan.stack = item->next;
+        pthread_mutex_unlock(&scan.lock);
+        
+        // A cancelled scan just empties the stack
+        if (!__atomic_load_n(&scan.cancel, __ATOMIC_RELAXED)) {
+            if (item->is_dir) {
+                scan_directory(item->path);
+            } else {
+                scan_parse_file(item->path);
+            }
+        }
+        free(item->path);
+        free(item);
+        
+        pthread_mutex_lock(&scan.lock);
+        if (--scan.pending == 0) pthread_cond_broadcast(&scan.cond);
+    }
+    pthread_mutex_unlock(&scan.lock);
+    
+    free_parse_scratch();
+    return NULL;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(str(*(const str_id_t *)a), str(*(const str_id_t *)b));
+}
+
+static int compare_stamps(const void *a, const void *b) {
+    return compare_paths(&((const file_stamp_t *)a)->path, &((const file_stamp_t *)b)->path);
+}
+
+static void *scan_thread(void *arg) {
+    (void)arg;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_count = cpus < 1 ? 1 : (cpus > MAX_SCAN_THREADS ? MAX_SCAN_THREADS : cpus);
+    pthread_t threads[MAX_SCAN_THREADS];
+    
+    // The parse cache only helps the first scan; later ones have records
+    if (scan.previous_count == 0) load_cache();
+    
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, scan_worker, NULL) == 0) started++;
+    }
+    if (started == 0) scan_worker(NULL);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    scan.cached_count = cache.count;
+    unload_cache();
+    
+    // Sorted for finish_scan() and the next scan to look paths up in
+    qsort(scan.seen, scan.seen_count, sizeof(str_id_t), compare_paths);
+    qsort(scan.found_empty, scan.found_empty_count, sizeof(file_stamp_t), compare_stamps);
+    
+    pthread_mutex_lock(&scan.lock);
+    scan.done = 1;
+    pthread_mutex_unlock(&scan.lock);
+    wake_main_loop();
+    return NULL;
+}
+
+// Start scanning the project in the background; the main loop applies what
+// it finds and calls finish_scan() at the end. Rescans reuse the records of
+// files whose mtime, size and inode are unchanged.
+void start_scan() {
+    if (scan.running) return;
+    scan.rescan_pending = 0;
+    
+    if (!grow_array((void **)&scan.previous, &scan.previous_capacity, docs.file_count + 1,
+                    sizeof(source_file_t *))) return;
+    if (docs.file_count > 0) {
+        memcpy(scan.previous, docs.files, docs.file_count * sizeof(source_file_t *));
+    }
+    scan.previous_count = docs.file_count;
+    
+    scan.seen_count = 0;
+    scan.found_empty_count = 0;
+    scan.retired_count = 0;
+    scan.updates = NULL;
+    scan.new_files = 0;
+    scan.changed_files = 0;
+    scan.cached_count = 0;
+    scan.parsed = 0;
+    scan.pending = 0;
+    scan.stack = NULL;
+    scan.done = 0;
+    scan.cancel = 0;
+    scan.cancelled = 0;
+    for (int i = 0; i < scan.dir_count; i++) {
+        free(scan.dirs[i]);
+    }
+    scan.dir_count = 0;
+    
+    char *root = strdup(".");
+    if (!root) return;
+    scan_push(root, 1);
+    
+    scan.running = 1;
+    scan.threaded = pthread_create(&scan.thread, NULL, scan_thread, NULL) == 0;
+    if (!scan.threaded) scan_thread(NULL);
+}
+
+// Stop a running scan. What it found so far stays listed; nothing is
+// dropped from the list, since the scan didn't get to see everything.
+void cancel_scan() {
+    if (scan.running) __atomic_store_n(&scan.cancel, 1, __ATOMIC_RELAXED);
+}
+
+// Free a record that left docs.files. Workers may still be reading it
+// through the snapshot while a scan runs.
+static void retire_source_file(source_file_t *file) {
+    if (!scan.running) {
+        free_source_file(file);
+    } else if (grow_array((void **)&scan.retired, &scan.retired_capacity, scan.retired_count + 1,
+                          sizeof(source_file_t *))) {
+        scan.retired[scan.retired_count++] = file;
+    }
+    // else: leak it rather than free it under the workers
+}
+
+// Documentation persistence
+//
+// DOCS_FILE is the canonical store. Edits don't rewrite it: each one
+// appends a record in the same format to JOURNAL_FILE, and loading replays
+// the journal over the canonical file. The journal is folded back into
+// DOCS_FILE by compact_documentation() once it outgrows
+// JOURNAL_COMPACT_BYTES, and on exit. DOCS_FILE can't be rewritten before
+// the first scan has listed every file, so a record that could go neither
+// to the journal nor to a rewrite waits in memory until it can.
+typedef enum {
+    FSYNC_ALWAYS,               // fsync after every journal append
+    FSYNC_GROUP,                // one fsync per GROUP_COMMIT_MS of appends
+    FSYNC_NEVER                 // leave it to the kernel
+} fsync_policy_t;
+
+static struct {
+    int fd;
+    off_t size;
+    fsync_policy_t fsync_policy;
+    
+    // Group commit: appends mark the journal dirty and the committer
+    // thread syncs it once the window has passed
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int dirty;
+    int committer_running;
+    
+    // Records waiting for the first scan to finish, replayed on every load
+    char *pending;
+    size_t pending_size;
+} journal = {
+    .fd = -1,
+    .fsync_policy = FSYNC_ALWAYS,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+static void write_doc_record(FILE *f, const function_t *func) {
+    const function_docs_t *doc = get_docs(func);
+    fprintf(f, "FUNCTION: %s\n", str(func->name));
+    fprintf(f, "FILE: %s\n", str(func->filename));
+    fprintf(f, "LINE: %d\n", func->line_number);
+    fprintf(f, "SIGNATURE: %s\n", str(func->signature));
+    fprintf(f, "DESCRIPTION: %s\n", doc->description);
+    fprintf(f, "PARAMETERS: %s\n", doc->parameters);
+    fprintf(f, "RETURN: %s\n", doc->return_value);
+    fprintf(f, "EXAMPLE: %s\n", doc->example);
+    fprintf(f, "NOTES: %s\n", doc->notes);
+    fprintf(f, "---\n");
+}
+
+// Write the whole store to a temp file and rename it over DOCS_FILE, so a
+// crash leaves either the old or the new file, never a torn one. Returns
+// 1 once the new file is durable.
+int save_documentation() {
+    // Documentation of files that aren't listed yet would be lost
+    if (!docs.complete) return 0;
+    
+    char tmp_path[] = DOCS_FILE ".tmp";
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) return 0;
+    
+    fprintf(f, "# Project Documentation\n");
+    fprintf(f, "# Auto-generated - do not edit the function signatures\n\n");
+    
+    for (int i = 0; i < docs.file_count; i++) {
+        source_file_t *file = docs.files[i];
+        for (int j = 0; j < file->function_count; j++) {
+            function_t *func = &file->functions[j];
+            if (func->is_documented) {
+                write_doc_record(f, func);
+            }
+        }
+    }
+    
+    int ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0 || !ok || rename(tmp_path, DOCS_FILE) != 0) {
+        unlink(tmp_path);
+        return 0;
+    }
+    
+    // Make the rename itself durable
+    int dir = open(".", O_RDONLY | O_DIRECTORY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+    return 1;
+}
+
+// Flush whatever the committer hasn't synced yet
+void sync_journal() {
+    pthread_mutex_lock(&journal.lock);
+    if (journal.dirty && journal.fd >= 0) fdatasync(journal.fd);
+    journal.dirty = 0;
+    pthread_mutex_unlock(&journal.lock);
+}
+
+// Rewrite DOCS_FILE with everything in memory and drop the journal
+void compact_documentation() {
+    if (journal.fd < 0) {
+        struct stat st;
+        if (stat(JOURNAL_FILE, &st) != 0) return;  // nothing to fold in
+    }
+    
+    // Keep the journal if the new docs file didn't make it to disk
+    if (!save_documentation()) {
+        sync_journal();
+        return;
+    }
+    
+    pthread_mutex_lock(&journal.lock);
+    if (journal.fd >= 0) {
+        close(journal.fd);
+        journal.fd = -1;
+    }
+    journal.dirty = 0;
+    pthread_mutex_unlock(&journal.lock);
+    
+    unlink(JOURNAL_FILE);
+    journal.size = 0;
+}
+
+// Syncs the journal at most once per GROUP_COMMIT_MS, however many edits
+// land in between. It works on a dup of the fd so compaction can close the
+// journal underneath it.
+static void *journal_committer(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&journal.lock);
+    while (1) {
+        while (!journal.dirty) pthread_cond_wait(&journal.cond, &journal.lock);
+        
+        pthread_mutex_unlock(&journal.lock);
+        usleep(GROUP_COMMIT_MS * 1000);
+        pthread_mutex_lock(&journal.lock);
+        
+        if (!journal.dirty || journal.fd < 0) continue;
+        int fd = dup(journal.fd);
+        journal.dirty = 0;
+        pthread_mutex_unlock(&journal.lock);
+        
+        if (fd >= 0) {
+            fdatasync(fd);
+            close(fd);
+        }
+        pthread_mutex_lock(&journal.lock);
+    }
+    return NULL;
+}
+
+static void schedule_journal_sync() {
+    pthread_mutex_lock(&journal.lock);
+    if (!journal.committer_running) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, journal_committer, NULL) != 0) {
+            pthread_mutex_unlock(&journal.lock);
+            fdatasync(journal.fd);
+            return;
+        }
+        pthread_detach(thread);
+        journal.committer_running = 1;
+    }
+    journal.dirty = 1;
+    pthread_cond_signal(&journal.cond);
+    pthread_mutex_unlock(&journal.lock);
+}
+
+// Persist the documentation of one function
+// Keep a record that isn't on disk until save_documentation() can run
+static void defer_record(const char *record, size_t len) {
+    char *pending = realloc(journal.pending, journal.pending_size + len);
+    if (!pending) return;
+    memcpy(pending + journal.pending_size, record, len);
+    journal.pending = pending;
+    journal.pending_size += len;
+}
+
+// Write the deferred records out once DOCS_FILE may be rewritten
+static void save_pending_documentation() {
+    if (!journal.pending || !save_documentation()) return;
+    free(journal.pending);
+    journal.pending = NULL;
+    journal.pending_size = 0;
+}
+
+// Persist the documentation of one function. Returns 0 if it is only in
+// memory for now, waiting for the first scan to finish.
+int record_documentation(const function_t *func) {
+    // Format the record first so it goes out in a single append
+    char *record = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&record, &len);
+    if (!f) return 0;
+    write_doc_record(f, func);
+    fclose(f);
+    
+    if (journal.fd < 0) {
+        int fd = open(JOURNAL_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        pthread_mutex_lock(&journal.lock);
+        journal.fd = fd;
+        pthread_mutex_unlock(&journal.lock);
+        if (journal.fd < 0) {
+            // Can't journal; fall back to a full rewrite
+            int saved = save_documentation();
+            if (!saved) defer_record(record, len);
+            free(record);
+            return saved;
+        }
+        struct stat st;
+        journal.size = fstat(journal.fd, &st) == 0 ? st.st_size : 0;
+    }
+    
+    ssize_t written = write(journal.fd, record, len);
+    if (written != (ssize_t)len) {
+        if (!docs.complete) defer_record(record, len);
+        free(record);
+        compact_documentation();
+        return docs.complete;
+    }
+    free(record);
+    journal.size += written;
+    
+    switch (journal.fsync_policy) {
+        case FSYNC_ALWAYS:
+            fdatasync(journal.fd);
+            break;
+        case FSYNC_GROUP:
+            schedule_journal_sync();
+            break;
+        case FSYNC_NEVER:
+            break;
+    }
+    
+    if (journal.size > JOURNAL_COMPACT_BYTES) compact_documentation();
+    return 1;
+}
+
+// Attach the records in `f` to their functions; with `only`, just the
+// records of that function
+static void load_documentation_stream(FILE *f, const function_t *only) {
+    // Lines, names and paths can be any length
+    char *line = NULL;
+    size_t line_capacity = 0;
+    char *current_func_name = NULL;
+    char *current_filename = NULL;
+    function_t *func = NULL;
+    int resolved = 0;
+    
+    while (getline(&line, &line_capacity, f) != -1) {
+        trim_whitespace(line);
+        
+        if (strncmp(line, "FUNCTION: ", 10) == 0) {
+            free(current_func_name);
+            current_func_name = strdup(line + 10);
+            resolved = 0;
+        } else if (strncmp(line, "FILE: ", 6) == 0) {
+            free(current_filename);
+            current_filename = strdup(line + 6);
+            resolved = 0;
+        } else if (current_func_name && current_func_name[0] && current_filename && current_filename[0]) {
+            // Find the function in our parsed data, once per record.
+            // Names that were never interned can't belong to a parsed function.
+            if (!resolved) {
+                str_id_t file_id = find_string(current_filename);
+                str_id_t name_id = find_string(current_func_name);
+                func = file_id != NO_STRING && name_id != NO_STRING ?
+                       find_function(file_id, name_id) : NULL;
+                if (only && func != only) func = NULL;
+                resolved = 1;
+            }
+            
+            function_docs_t *doc = func ? edit_docs(func) : NULL;
+            if (doc) {
+                if (strncmp(line, "DESCRIPTION: ", 13) == 0) {
+                    set_doc_text(&doc->description, line + 13);
+                    set_documented(func);
+                } else if (strncmp(line, "PARAMETERS: ", 12) == 0) {
+                    set_doc_text(&doc->parameters, line + 12);
+                } else if (strncmp(line, "RETURN: ", 8) == 0) {
+                    set_doc_text(&doc->return_value, line + 8);
+                } else if (strncmp(line, "EXAMPLE: ", 9) == 0) {
+                    set_doc_text(&doc->example, line + 9);
+                } else if (strncmp(line, "NOTES: ", 7) == 0) {
+                    set_doc_text(&doc->notes, line + 7);
+                } else if (strcmp(line, "---") == 0) {
+                    free(current_func_name);
+                    free(current_filename);
+                    current_func_name = current_filename = NULL;
+                    resolved = 0;
+                }
+            }
+        }
+    }
+    
+    free(line);
+    free(current_func_name);
+    free(current_filename);
+}
+
+static void load_documentation_file(const char *path, const function_t *only) {
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    load_documentation_stream(f, only);
+    fclose(f);
+}
+
+static void load_documentation_records(const function_t *only) {
+    load_documentation_file(DOCS_FILE, only);
+    load_documentation_file(JOURNAL_FILE, only);
+    // Edits that aren't on disk yet are newer than both
+    FILE *pending = journal.pending ? fmemopen(journal.pending, journal.pending_size, "r") : NULL;
+    if (pending) {
+        load_documentation_stream(pending, only);
+        fclose(pending);
+    }
+    invalidate_search_index();
+}
+
+void load_documentation() {
+    load_documentation_records(NULL);
+}
+
+// The first scan loads the documentation only once it has listed every
+// file. The editor keeps the fields left empty and records all of them,
+// so before then it loads the function's own record first; otherwise the
+// saved fields would be shown empty and journaled over.
+static void load_function_documentation(const function_t *func) {
+    if (!docs.complete) load_documentation_records(func);
+}
+
+// Search and filter functions
+#define MAX_QUERY_TERMS 16
+#define SEARCH_VERIFY_LIMIT 16384  // candidates checked in full before results go partial
+#define SEARCH_REGEX_PREFIX '/'    // marks a query as a regular expression
+#define SEARCH_BODY_PREFIX "body:" // marks a term as an identifier used in the body
+
+static int compare_list_sizes(const void *a, const void *b) {
+    const posting_list_t *x = *(posting_list_t *const *)a, *y = *(posting_list_t *const *)b;
+    return x->count < y->count ? -1 : x->count > y->count;
+}
+
+static int function_contains(const function_t *func, const char *term) {
+    return strcasestr(str(func->name), term) || strcasestr(str(func->signature), term) ||
+           strcasestr(get_docs(func)->description, term);
+}
+
+// Functions matching a query, as ordinals. A set is complete when it
+// holds every match; scans that can't use the index stop at MAX_ITEMS and
+// leave it partial.
+typedef struct {
+    uint32_t *ordinals;
+    int count;
+    int capacity;
+    int complete;
+    int valid;
+    int narrowable;             // a longer plain query's matches are a subset
+} result_set_t;
+
+typedef struct {
+    char buffer[MAX_NAME_LENGTH];
+    char *terms[MAX_QUERY_TERMS];
+    str_id_t body[MAX_QUERY_TERMS];     // identifier of a body: term, NO_STRING otherwise
+    int count;
+} query_terms_t;
+
+static void split_query(const char *query, query_terms_t *q) {
+    strncpy(q->buffer, query, sizeof(q->buffer) - 1);
+    q->buffer[sizeof(q->buffer) - 1] = '\0';
+    q->count = 0;
+    for (char *save, *term = strtok_r(q->buffer, " \t", &save); term && q->count < MAX_QUERY_TERMS;
+         term = strtok_r(NULL, " \t", &save)) {
+        q->body[q->count] = NO_STRING;
+        if (strncmp(term, SEARCH_BODY_PREFIX, strlen(SEARCH_BODY_PREFIX)) == 0 &&
+            term[strlen(SEARCH_BODY_PREFIX)]) {
+            term += strlen(SEARCH_BODY_PREFIX);
+            // An identifier no file uses can't be in any body
+            q->body[q->count] = find_string(term);
+            if (q->body[q->count] == NO_STRING) q->body[q->count] = 0;
+        }
+        q->terms[q->count++] = term;
+    }
+}
+
+static int function_matches(uint32_t ordinal, const query_terms_t *q) {
+    func_ref_t ref = search_index.refs[ordinal];
+    const function_t *func = &docs.files[ref.file]->functions[ref.func];
+    const char *name = search_index.names + search_index.name_offsets[ordinal];
+    for (int t = 0; t < q->count; t++) {
+        if (q->body[t] != NO_STRING) {
+            if (!body_uses(docs.files[ref.file], ref.func, q->body[t])) return 0;
+            continue;
+        }
+        // The packed copy of the name is the cheap one to reach
+        if (!strcasestr(name, q->terms[t]) && !function_contains(func, q->terms[t])) return 0;
+    }
+    return 1;
+}
+
+static void add_result(result_set_t *set, uint32_t ordinal) {
+    if (!grow_array((void **)&set->ordinals, &set->capacity, set->count + 1, sizeof(uint32_t))) return;
+    set->ordinals[set->count++] = ordinal;
+}
+
+// A term's posting list is exact, with no need to check the strings, when
+// the term is a single trigram of characters that fold without collisions
+static int term_is_exact(const char *term) {
+    if (strlen(term) != 3) return 0;
+    for (int i = 0; i < 3; i++) {
+        if (!isalnum((unsigned char)term[i]) && term[i] != '_') return 0;
+    }
+    return 1;
+}
+
+// Functions whose name, signature or description contain every
+// whitespace-separated term of `query`, ignoring case; a body:ident term
+// instead requires the body to use that identifier. With `within`, only
+// its members are considered: extending a query can only drop matches, so
+// a longer query is answered by narrowing a prefix's complete results.
+// If more than `verify_limit` candidates need their strings checked, only
+// the first MAX_ITEMS matches are collected and the set is left partial.
+static void search_all(const char *query, const result_set_t *within, uint32_t verify_limit,
+                       result_set_t *set) {
+    set->count = 0;
+    set->complete = 1;
+    
+    query_terms_t q;
+    split_query(query, &q);
+    if (q.count == 0) return;
+    
+    // Every trigram of every term must be present; terms shorter than
+    // three characters only take part in verification
+    trigram_set_t query_trigrams = { 0 };
+    posting_list_t body_lists[MAX_QUERY_TERMS];
+    posting_list_t *lists[MAX_NAME_LENGTH + MAX_QUERY_TERMS + 1];
+    int list_count = 0;
+    int verify = 0, unused = 0;
+    for (int t = 0; t < q.count; t++) {
+        if (q.body[t] == NO_STRING) {
+            add_trigrams(q.terms[t], &query_trigrams);
+            if (!term_is_exact(q.terms[t])) verify = 1;
+        } else if (q.body[t] == 0) {
+            unused = 1;
+        } else if (body_list(q.body[t], &body_lists[t])) {
+            unused |= body_lists[t].count == 0;
+            lists[list_count++] = &body_lists[t];
+        } else {
+            verify = 1;
+        }
+    }
+    if (unused) {
+        free(query_trigrams.keys);
+        return;
+    }
+    sort_unique_keys(&query_trigrams);
+    
+    for (int k = 0; k < query_trigrams.count; k++) {
+        posting_list_t *list = posting_list(query_trigrams.keys[k], 0);
+        if (!list || list->count == 0) {
+            free(query_trigrams.keys);
+            return;
+        }
+        lists[list_count++] = list;
+    }
+    free(query_trigrams.keys);
+    
+    posting_list_t previous;
+    if (within) {
+        previous = (posting_list_t){ within->ordinals, within->count, within->capacity };
+        lists[list_count++] = &previous;
+    }
+    
+    // Walk the shortest list (or every function, if the query was all
+    // short terms) and seek forward in the others
+    qsort(lists, list_count, sizeof(posting_list_t *), compare_list_sizes);
+    uint32_t cursor[MAX_NAME_LENGTH + MAX_QUERY_TERMS + 1] = { 0 };
+    uint32_t candidates = list_count ? lists[0]->count : search_index.function_count;
+    
+    int bounded = verify && candidates > verify_limit;
+    
+    for (uint32_t n = 0; n < candidates; n++) {
+        uint32_t ordinal = list_count ? lists[0]->ordinals[n] : n;
+        int everywhere = 1;
+        for (int k = 1; k < list_count && everywhere; k++) {
+            cursor[k] = posting_seek(lists[k], cursor[k], ordinal);
+            if (cursor[k] == lists[k]->count) return;
+            everywhere = lists[k]->ordinals[cursor[k]] == ordinal;
+        }
+        if (!everywhere || (verify && !function_matches(ordinal, &q))) continue;
+        
+        add_result(set, ordinal);
+        if (bounded && set->count >= MAX_ITEMS) {
+            set->complete = n + 1 == candidates;
+            return;
+        }
+    }
+}
+
+static void publish_results(const result_set_t *set) {
+    docs.search_count = 0;
+    docs.search_complete = set->complete;
+    if (!grow_array((void **)&docs.search_results, &docs.search_capacity, set->count,
+                    sizeof(func_ref_t))) return;
+    for (int i = 0; i < set->count; i++) {
+        docs.search_results[i] = search_index.refs[set->ordinals[i]];
+    }
+    docs.search_count = set->count;
+}
+
+// Regex search
+//
+// A query starting with '/' is a POSIX extended regex, matched against the
+// name, signature and every documentation field. Compiled patterns are
+// kept in a small LRU cache. glibc serialises regexec() calls on one
+// regex_t, so each worker thread gets its own compilation of the pattern.
+// When the pattern has a literal every match must contain, only functions
+// holding its trigrams are tried.
+#define REGEX_CACHE_SIZE 8
+#define REGEX_CHUNK 4096            // functions per worker thread, at least
+
+typedef struct {
+    char pattern[MAX_NAME_LENGTH];
+    regex_t compiled[MAX_SCAN_THREADS];
+    int compiled_count;
+    uint64_t last_used;             // 0 if the slot is free
+} regex_entry_t;
+
+static struct {
+    regex_entry_t entries[REGEX_CACHE_SIZE];
+    uint64_t clock;
+} regex_cache;
+
+// The cached pattern, compiled at least `copies` times. On a bad pattern
+// returns NULL with the reason in `error`.
+static regex_entry_t *get_regex(const char *pattern, int copies, char *error, size_t error_size) {
+    regex_entry_t *entry = NULL, *victim = &regex_cache.entries[0];
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        regex_entry_t *e = &regex_cache.entries[i];
+        if (e->last_used && strcmp(e->pattern, pattern) == 0) {
+            entry = e;
+            break;
+        }
+        if (e->last_used < victim->last_used) victim = e;
+    }
+    
+    if (!entry) {
+        entry = victim;
+        for (int i = 0; i < entry->compiled_count; i++) regfree(&entry->compiled[i]);
+        entry->compiled_count = 0;
+        entry->last_used = 0;
+        strncpy(entry->pattern, pattern, MAX_NAME_LENGTH - 1);
+        entry->pattern[MAX_NAME_LENGTH - 1] = '\0';
+    }
+    
+    while (entry->compiled_count < copies) {
+        int rc = regcomp(&entry->compiled[entry->compiled_count], pattern, REG_EXTENDED | REG_NOSUB);
+        if (rc != 0) {
+            regerror(rc, &entry->compiled[entry->compiled_count], error, error_size);
+            regfree(&entry->compiled[entry->compiled_count]);
+            if (entry->compiled_count == 0) return NULL;
+            break;  // can still run with fewer threads
+        }
+        entry->compiled_count++;
+    }
+    
+    entry->last_used = ++regex_cache.clock;
+    return entry;
+}
+
+// Longest run of literal characters that every match of `pattern` must
+// contain. Only the top level is considered: groups and bracket
+// expressions are skipped, and a top-level alternation means there is none.
+static void required_literal(const char *pattern, char *literal, size_t size) {
+    char run[MAX_NAME_LENGTH];
+    size_t run_len = 0, best_len = 0;
+    int depth = 0, last_literal = 0;
+    literal[0] = '\0';
+    
+    for (const char *p = pattern; *p; p++) {
+        char c = *p;
+        int is_literal = 0;
+        
+        if (c == '\\' && p[1]) {
+            // \. is a literal dot; \w and friends are classes
+            c = *++p;
+            is_literal = !isalnum((unsigned char)c);
+        } else if (c == '[') {
+            // Skip the bracket expression, including a leading ] or ^]
+            p++;
+            if (*p == '^') p++;
+            if (*p == ']') p++;
+            while (*p && *p != ']') p++;
+            if (!*p) break;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (depth > 0) depth--;
+        } else if (c == '|') {
+            if (depth == 0) {
+                literal[0] = '\0';
+                return;
+            }
+        } else if (c == '*' || c == '?' || c == '{') {
+            // The previous character was optional after all
+            if (last_literal && run_len > 0) run_len--;
+            if (c == '{') {
+                while (*p && *p != '}') p++;
+                if (!*p) break;
+            }
+        } else if (c != '+' && c != '.' && c != '^' && c != '$') {
+            is_literal = 1;
+        }
+        
+        if (is_literal && depth == 0 && run_len < sizeof(run)) {
+            run[run_len++] = c;
+        } else if (!is_literal || depth > 0) {
+            if (run_len > best_len && run_len < size) {
+                memcpy(literal, run, run_len);
+                literal[run_len] = '\0';
+                best_len = run_len;
+            }
+            run_len = 0;
+        }
+        last_literal = is_literal && depth == 0;
+    }
+    if (run_len > best_len && run_len < size) {
+        memcpy(literal, run, run_len);
+        literal[run_len] = '\0';
+    }
+}
+
+// Functions that may contain `literal` in some field: those whose name,
+// signature and description have all of its trigrams, plus every function
+// with documentation, as the other documentation fields aren't indexed
+static void literal_candidates(const char *literal, result_set_t *set) {
+    trigram_set_t trigrams = { 0 };
+    add_trigrams(literal, &trigrams);
+    sort_unique_keys(&trigrams);
+    
+    posting_list_t *lists[MAX_NAME_LENGTH];
+    int list_count = 0;
+    for (int k = 0; k < trigrams.count; k++) {
+        posting_list_t *list = posting_list(trigrams.keys[k], 0);
+        if (!list || list->count == 0) {
+            list_count = 0;     // no indexed field can hold it
+            break;
+        }
+        lists[list_count++] = list;
+    }
+    free(trigrams.keys);
+    
+    uint32_t cursor[MAX_NAME_LENGTH] = { 0 };
+    for (uint32_t ordinal = 0; ordinal < search_index.function_count; ordinal++) {
+        int listed = list_count > 0;
+        for (int k = 0; k < list_count && listed; k++) {
+            cursor[k] = posting_seek(lists[k], cursor[k], ordinal);
+            listed = cursor[k] < lists[k]->count && lists[k]->ordinals[cursor[k]] == ordinal;
+        }
+        func_ref_t ref = search_index.refs[ordinal];
+        if (listed || docs.files[ref.file]->functions[ref.func].docs) add_result(set, ordinal);
+    }
+}
+
+// A field matches when it contains `literal` (if any) and `regex` matches
+// it; the plain substring check turns most candidates away cheaply
+static int function_matches_regex(uint32_t ordinal, const regex_t *regex, const char *literal) {
+    func_ref_t ref = search_index.refs[ordinal];
+    const function_t *func = &docs.files[ref.file]->functions[ref.func];
+    const function_docs_t *doc = get_docs(func);
+    const char *fields[] = {
+        search_index.names + search_index.name_offsets[ordinal], str(func->signature),
+        doc->description, doc->parameters, doc->return_value, doc->example, doc->notes
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (!fields[i][0] || (literal[0] && !strcasestr(fields[i], literal))) continue;
+        if (regexec(regex, fields[i], 0, NULL, 0) == 0) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    const regex_t *regex;
+    const char *literal;            // every match contains it; "" if none is known
+    const uint32_t *candidates;     // NULL: every ordinal in [begin, end)
+    uint32_t begin, end;
+    result_set_t found;
+} regex_task_t;
+
+static void *regex_worker(void *arg) {
+    regex_task_t *task = arg;
+    for (uint32_t n = task->begin; n < task->end; n++) {
+        uint32_t ordinal = task->candidates ? task->candidates[n] : n;
+        if (function_matches_regex(ordinal, task->regex, task->literal)) add_result(&task->found, ordinal);
+    }
+    return NULL;
+}
+
+// Functions with a field matching `pattern`
+static void regex_search(const char *pattern, result_set_t *set) {
+    set->count = 0;
+    set->complete = 1;
+    docs.search_error[0] = '\0';
+    if (!pattern[0]) return;
+    
+    // Narrow through the index when the pattern has a usable literal
+    char literal[MAX_NAME_LENGTH];
+    result_set_t candidates = { 0 };
+    required_literal(pattern, literal, sizeof(literal));
+    if (strlen(literal) >= 3) {
+        literal_candidates(literal, &candidates);
+    } else {
+        literal[0] = '\0';
+    }
+    uint32_t total = literal[0] ? (uint32_t)candidates.count : search_index.function_count;
+    
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int task_count = total / REGEX_CHUNK + 1;
+    if (task_count > cpus) task_count = cpus < 1 ? 1 : cpus;
+    if (task_count > MAX_SCAN_THREADS) task_count = MAX_SCAN_THREADS;
+    
+    regex_entry_t *entry = get_regex(pattern, task_count, docs.search_error, sizeof(docs.search_error));
+    regex_task_t *tasks = entry ? calloc(task_count, sizeof(regex_task_t)) : NULL;
+    if (!tasks) {
+        free(candidates.ordinals);
+        return;
+    }
+    if (task_count > entry->compiled_count) task_count = entry->compiled_count;
+    
+    for (int t = 0; t < task_count; t++) {
+        tasks[t].regex = &entry->compiled[t];
+        tasks[t].literal = literal;
+        tasks[t].candidates = literal[0] ? candidates.ordinals : NULL;
+        tasks[t].begin = (uint64_t)total * t / task_count;
+        tasks[t].end = (uint64_t)total * (t + 1) / task_count;
+    }
+    
+    // The calling thread takes the first chunk itself
+    pthread_t threads[MAX_SCAN_THREADS];
+    int started = 1;
+    for (; started < task_count; started++) {
+        if (pthread_create(&threads[started], NULL, regex_worker, &tasks[started]) != 0) break;
+    }
+    regex_worker(&tasks[0]);
+    for (int t = started; t < task_count; t++) regex_worker(&tasks[t]);
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
+    
+    // Chunks are in ordinal order, so concatenating keeps the results sorted
+    for (int t = 0; t < task_count; t++) {
+        result_set_t *found = &tasks[t].found;
+        if (grow_array((void **)&set->ordinals, &set->capacity, set->count + found->count, sizeof(uint32_t))) {
+            memcpy(set->ordinals + set->count, found->ordinals, found->count * sizeof(uint32_t));
+            set->count += found->count;
+        }
+        free(found->ordinals);
+    }
+    free(tasks);
+    free(candidates.ordinals);
+}
+
+// Query language
+//
+// A query with fields or operators is parsed into a small tree:
+//
+//   name:X  file:X  ret:X  doc:X  body:X  is:documented  is:undocumented
+//   a b  a AND b  a OR b  NOT a  -a  ( ... )  field:"with spaces"
+//
+// name: and file: take a glob when X has * ? or [, and a substring
+// otherwise (file: globs also try the base name, so net_*.c finds
+// src/net_tcp.c). ret: is the return type without static, inline or
+// extern; doc: searches every documentation field. The tree is evaluated
+// over bitsets of ordinals, every node only within the set its parent has
+// narrowed to so far, and an AND runs its cheapest children first: bit
+// filters and per-file matches shrink the set before any string of a
+// single function is looked at.
+#define MAX_QUERY_NODES 64
+
+typedef enum {
+    QUERY_DOCUMENTED,           // leaves, cheapest first
+    QUERY_UNDOCUMENTED,
+    QUERY_FILE,
+    QUERY_BODY,
+    QUERY_RET,
+    QUERY_NAME,
+    QUERY_TEXT,
+    QUERY_DOC,
+    QUERY_AND,
+    QUERY_OR,
+    QUERY_NOT
+} query_kind_t;
+
+typedef struct {
+    query_kind_t kind;
+    const char *value;          // leaves: points into the token buffer
+    int child;                  // first operand, -1 if none
+    int next;                   // next operand of the parent, -1 if last
+    str_id_t id;                // body: the identifier, NO_STRING if no file uses it
+    uint8_t *memo;              // ret: per return type string, 0 unknown, 1 no, 2 yes
+} query_node_t;
+
+typedef struct {
+    char buffer[2 * MAX_NAME_LENGTH];
+    char *tokens[MAX_NAME_LENGTH];
+    int quoted[MAX_NAME_LENGTH];
+    int token_count;
+    int pos;
+    query_node_t nodes[MAX_QUERY_NODES];
+    int node_count;
+    const char *error;
+} query_t;
+
+static const struct {
+    const char *prefix;
+    query_kind_t kind;
+} query_fields[] = {
+    { "name:", QUERY_NAME }, { "file:", QUERY_FILE }, { "ret:", QUERY_RET },
+    { "doc:", QUERY_DOC }, { "body:", QUERY_BODY }, { "is:", QUERY_DOCUMENTED }, { NULL, 0 }
+};
+
+static int is_query_operator(const char *word, size_t len) {
+    return (len == 3 && (strncmp(word, "AND", 3) == 0 || strncmp(word, "NOT", 3) == 0)) ||
+           (len == 2 && strncmp(word, "OR", 2) == 0);
+}
+
+// Whether `query` needs the query language rather than the plain
+// all-fragments search. body: alone doesn't: search_all() handles it.
+static int is_structured_query(const char *query) {
+    const char *p = query;
+    while (*p) {
+        while (*p == ' ' || *p == '\t') p++;
+        const char *word = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        size_t len = p - word;
+        if (len == 0) break;
+        
+        if (is_query_operator(word, len) || word[0] == '(' ||
+            (word[0] == '-' && len > 1 && (isalpha((unsigned char)word[1]) || word[1] == '('))) return 1;
+        for (int f = 0; query_fields[f].prefix; f++) {
+            size_t n = strlen(query_fields[f].prefix);
+            if (query_fields[f].kind != QUERY_BODY && len > n - 1 &&
+                strncmp(word, query_fields[f].prefix, n) == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+// Split into words and parentheses; double quotes keep spaces and
+// parentheses inside a word
+static void tokenize_query(const char *query, query_t *q) {
+    char *out = q->buffer;
+    char *limit = q->buffer + sizeof(q->buffer) - 2;
+    q->token_count = 0;
+    
+    const char *p = query;
+    while (*p && out < limit && q->token_count < MAX_NAME_LENGTH) {
+        if (*p == ' ' || *p == '\t') {
+            p++;
+            continue;
+        }
+        q->tokens[q->token_count] = out;
+        q->quoted[q->token_count] = 0;
+        if (*p == '(' || *p == ')') {
+            *out++ = *p++;
+        } else {
+            int quoting = 0;
+            for (; *p && out < limit; p++) {
+                if (*p == '"') {
+                    quoting = !quoting;
+                    q->quoted[q->token_count] = 1;
+                } else if (!quoting && (*p == ' ' || *p == '\t' || *p == '(' || *p == ')')) {
+                    break;
+                } else {
+                    *out++ = *p;
+                }
+            }
+        }
+        *out++ = '\0';
+        q->token_count++;
+    }
+}
+
+static const char *peek_token(const query_t *q) {
+    return q->pos < q->token_count ? q->tokens[q->pos] : NULL;
+}
+
+static int token_is(const query_t *q, const char *word) {
+    const char *token = peek_token(q);
+    return token && !q->quoted[q->pos] && strcmp(token, word) == 0;
+}
+
+static int new_query_node(query_t *q, query_kind_t kind, const char *value) {
+    if (q->node_count == MAX_QUERY_NODES) {
+        q->error = "Query is too long";
+        return -1;
+    }
+    query_node_t *node = &q->nodes[q->node_count];
+    node->kind = kind;
+    node->value = value;
+    node->child = -1;
+    node->next = -1;
+    node->memo = NULL;
+    return q->node_count++;
+}
+
+static int parse_query_or(query_t *q);
+
+static int parse_query_leaf(query_t *q, char *token) {
+    q->pos++;
+    for (int f = 0; query_fields[f].prefix; f++) {
+        size_t n = strlen(query_fields[f].prefix);
+        if (strncmp(token, query_fields[f].prefix, n) != 0) continue;
+        
+        const char *value = token + n;
+        if (!*value) {
+            q->error = "Missing value after a field";
+            return -1;
+        }
+        if (query_fields[f].kind != QUERY_DOCUMENTED) return new_query_node(q, query_fields[f].kind, value);
+        if (strcmp(value, "documented") == 0) return new_query_node(q, QUERY_DOCUMENTED, value);
+        if (strcmp(value, "undocumented") == 0) return new_query_node(q, QUERY_UNDOCUMENTED, value);
+        q->error = "is: takes documented or undocumented";
+        return -1;
+    }
+    return new_query_node(q, QUERY_TEXT, token);
+}
+
+static int parse_query_unary(query_t *q) {
+    char *token = (char *)peek_token(q);
+    if (!token) {
+        q->error = "Missing term";
+        return -1;
+    }
+    
+    int negate = 0;
+    if (token_is(q, "NOT")) {
+        q->pos++;
+        negate = 1;
+    } else if (token[0] == '-' && token[1] && !q->quoted[q->pos]) {
+        q->tokens[q->pos]++;
+        negate = 1;
+    } else if (token_is(q, "-") && q->pos + 1 < q->token_count && strcmp(q->tokens[q->pos + 1], "(") == 0) {
+        q->pos++;
+        negate = 1;
+    }
+    if (negate) {
+        int operand = parse_query_unary(q);
+        if (operand < 0) return -1;
+        int node = new_query_node(q, QUERY_NOT, NULL);
+        if (node >= 0) q->nodes[node].child = operand;
+        return node;
+    }
+    
+    if (token_is(q, "(")) {
+        q->pos++;
+        int node = parse_query_or(q);
+        if (node < 0) return -1;
+        if (!token_is(q, ")")) {
+            q->error = "Missing )";
+            return -1;
+        }
+        q->pos++;
+        return node;
+    }
+    if (token_is(q, ")") || token_is(q, "AND") || token_is(q, "OR")) {
+        q->error = "Missing term";
+        return -1;
+    }
+    return parse_query_leaf(q, token);
+}
+
+// Operands separated by `separator` (NULL: just juxtaposed) under one
+// `kind` node, or the single operand itself
+static int parse_query_list(query_t *q, query_kind_t kind, const char *separator,
+                            int (*operand)(query_t *)) {
+    int first = operand(q);
+    if (first < 0) return -1;
+    
+    int last = first, count = 1;
+    while (peek_token(q) && !token_is(q, ")") && (separator ? token_is(q, separator) : !token_is(q, "OR"))) {
+        if (separator || token_is(q, "AND")) q->pos++;
+        int next = operand(q);
+        if (next < 0) return -1;
+        q->nodes[last].next = next;
+        last = next;
+        count++;
+    }
+    if (count == 1) return first;
+    
+    int node = new_query_node(q, kind, NULL);
+    if (node >= 0) q->nodes[node].child = first;
+    return node;
+}
+
+static int parse_query_and(query_t *q) {
+    return parse_query_list(q, QUERY_AND, NULL, parse_query_unary);
+}
+
+static int parse_query_or(query_t *q) {
+    return parse_query_list(q, QUERY_OR, "OR", parse_query_and);
+}
+
+// Relative cost of evaluating a node over the same set
+static int query_cost(const query_t *q, int n) {
+    const query_node_t *node = &q->nodes[n];
+    if (node->kind < QUERY_AND) return node->kind;
+    int cost = 0;
+    for (int c = node->child; c >= 0; c = q->nodes[c].next) {
+        int child = query_cost(q, c);
+        if (child > cost) cost = child;
+    }
+    return cost;
+}
+
+static int has_glob(const char *value) {
+    return strpbrk(value, "*?[") != NULL;
+}
+
+// Return type with storage class words dropped and spaces removed
+static void normalize_return_type(const char *type, char *out, size_t size) {
+    size_t len = 0;
+    while (*type && len + 1 < size) {
+        while (*type == ' ' || *type == '\t') type++;
+        const char *word = type;
+        while (*type && *type != ' ' && *type != '\t') type++;
+        size_t n = type - word;
+        if (n == 6 && (strncmp(word, "static", 6) == 0 || strncmp(word, "extern", 6) == 0 ||
+                       strncmp(word, "inline", 6) == 0)) continue;
+        if (n > size - len - 1) n = size - len - 1;
+        memcpy(out + len, word, n);
+        len += n;
+    }
+    out[len] = '\0';
+}
+
+static int documentation_contains(const function_t *func, const char *term) {
+    const function_docs_t *doc = get_docs(func);
+    return strcasestr(doc->description, term) || strcasestr(doc->parameters, term) ||
+           strcasestr(doc->return_value, term) || strcasestr(doc->example, term) ||
+           strcasestr(doc->notes, term);
+}
+
+static inline int bit_is_set(const uint64_t *bits, uint32_t n) {
+    return bits[n / 64] >> (n % 64) & 1;
+}
+
+static inline void set_bit(uint64_t *bits, uint32_t n) {
+    bits[n / 64] |= 1ULL << (n % 64);
+}
+
+static int leaf_matches(query_node_t *node, uint32_t ordinal) {
+    func_ref_t ref = search_index.refs[ordinal];
+    const function_t *func = &docs.files[ref.file]->functions[ref.func];
+    const char *name = search_index.names + search_index.name_offsets[ordinal];
+    
+    switch (node->kind) {
+        case QUERY_DOCUMENTED:
+            return bit_is_set(search_index.documented, ordinal);
+        case QUERY_UNDOCUMENTED:
+            return !bit_is_set(search_index.documented, ordinal);
+        case QUERY_BODY:
+            return body_uses(docs.files[ref.file], ref.func, node->id);
+        case QUERY_RET: {
+            uint8_t *memo = node->memo ? &node->memo[func->return_type] : NULL;
+            if (memo && *memo) return *memo == 2;
+            char type[MAX_NAME_LENGTH], wanted[MAX_NAME_LENGTH];
+            normalize_return_type(str(func->return_type), type, sizeof(type));
+            normalize_return_type(node->value, wanted, sizeof(wanted));
+            int match = strcasecmp(type, wanted) == 0;
+            if (memo) *memo = match ? 2 : 1;
+            return match;
+        }
+        case QUERY_NAME:
+            return has_glob(node->value) ? fnmatch(node->value, name, FNM_CASEFOLD) == 0
+                                         : strcasestr(name, node->value) != NULL;
+        case QUERY_TEXT:
+            return strcasestr(name, node->value) || function_contains(func, node->value);
+        case QUERY_DOC:
+            return bit_is_set(search_index.documented, ordinal) && documentation_contains(func, node->value);
+        default:
+            return 0;
+    }
+}
+
+// The sorted lists every match of a leaf is on. Returns their number, or
+// -1 if the leaf can't match anything.
+static int leaf_lists(query_node_t *node, posting_list_t **lists, posting_list_t *body) {
+    int count = 0;
+    if (node->kind == QUERY_BODY) {
+        if (node->id == NO_STRING) return -1;
+        if (body_list(node->id, body)) lists[count++] = body;
+    } else if (node->kind == QUERY_TEXT || (node->kind == QUERY_NAME && !has_glob(node->value))) {
+        trigram_set_t trigrams = { 0 };
+        add_trigrams(node->value, &trigrams);
+        for (int k = 0; k < trigrams.count && count < MAX_NAME_LENGTH; k++) {
+            posting_list_t *list = posting_list(trigrams.keys[k], 0);
+            if (!list) {
+                count = -1;
+                break;
+            }
+            lists[count++] = list;
+        }
+        free(trigrams.keys);
+    }
+    if (count > 0) qsort(lists, count, sizeof(posting_list_t *), compare_list_sizes);
+    return count > 0 && lists[0]->count == 0 ? -1 : count;
+}
+
+static void eval_leaf(query_node_t *node, const uint64_t *within, uint64_t *out, uint32_t words) {
+    if (node->kind == QUERY_FILE) {
+        int glob = has_glob(node->value);
+        for (int i = 0; i < docs.file_count; i++) {
+            const char *path = str(docs.files[i]->filename);
+            const char *base = strrchr(path, '/');
+            base = base ? base + 1 : path;
+            int match = glob ? fnmatch(node->value, path, 0) == 0 || fnmatch(node->value, base, 0) == 0
+                             : strcasestr(path, node->value) != NULL;
+            if (!match) continue;
+            for (uint32_t n = search_index.file_base[i]; n < search_index.file_base[i + 1]; n++) {
+                if (bit_is_set(within, n)) set_bit(out, n);
+            }
+        }
+        return;
+    }
+    
+    if (node->kind == QUERY_BODY) node->id = find_string(node->value);
+    
+    posting_list_t *lists[MAX_NAME_LENGTH];
+    posting_list_t body;
+    int list_count = leaf_lists(node, lists, &body);
+    if (list_count < 0) return;
+    
+    if (node->kind == QUERY_RET) node->memo = calloc(strings.count, 1);
+    
+    uint32_t population = 0;
+    for (uint32_t w = 0; w < words; w++) population += __builtin_popcountll(within[w]);
+    
+    if (list_count > 0 && lists[0]->count < population) {
+        // Walk the shortest list, seeking forward in the others
+        uint32_t cursor[MAX_NAME_LENGTH] = { 0 };
+        for (uint32_t i = 0; i < lists[0]->count; i++) {
+            uint32_t ordinal = lists[0]->ordinals[i];
+            int everywhere = bit_is_set(within, ordinal);
+            for (int k = 1; k < list_count && everywhere; k++) {
+                cursor[k] = posting_seek(lists[k], cursor[k], ordinal);
+                if (cursor[k] == lists[k]->count) return;
+                everywhere = lists[k]->ordinals[cursor[k]] == ordinal;
+            }
+            if (everywhere && leaf_matches(node, ordinal)) set_bit(out, ordinal);
+        }
+    } else {
+        for (uint32_t w = 0; w < words; w++) {
+            for (uint64_t bits = within[w]; bits; bits &= bits - 1) {
+                uint32_t ordinal = w * 64 + __builtin_ctzll(bits);
+                if (leaf_matches(node, ordinal)) set_bit(out, ordinal);
+            }
+        }
+    }
+    free(node->memo);
+    node->memo = NULL;
+}
+
+// out = within ∩ matches of node n. `out` starts zeroed.
+static void eval_query(query_t *q, int n, const uint64_t *within, uint64_t *out, uint32_t words) {
+    query_node_t *node = &q->nodes[n];
+    if (node->kind < QUERY_AND) {
+        eval_leaf(node, within, out, words);
+        return;
+    }
+    
+    uint64_t *scratch = calloc(words ? words : 1, sizeof(uint64_t));
+    if (!scratch) return;
+    
+    if (node->kind == QUERY_NOT) {
+        eval_query(q, node->child, within, scratch, words);
+        for (uint32_t w = 0; w < words; w++) out[w] = within[w] & ~scratch[w];
+    } else if (node->kind == QUERY_OR) {
+        // Later operands only need to look at what earlier ones didn't match
+        uint64_t *rest = malloc((words ? words : 1) * sizeof(uint64_t));
+        if (rest) {
+            memcpy(rest, within, words * sizeof(uint64_t));
+            for (int c = node->child; c >= 0; c = q->nodes[c].next) {
+                memset(scratch, 0, words * sizeof(uint64_t));
+                eval_query(q, c, rest, scratch, words);
+                for (uint32_t w = 0; w < words; w++) {
+                    out[w] |= scratch[w];
+                    rest[w] &= ~scratch[w];
+                }
+            }
+            free(rest);
+        }
+    } else {
+        // Cheapest operands first, each within what the previous ones left
+        int order[MAX_QUERY_NODES], count = 0;
+        for (int c = node->child; c >= 0; c = q->nodes[c].next) {
+            int i = count++;
+            while (i > 0 && query_cost(q, order[i - 1]) > query_cost(q, c)) {
+                order[i] = order[i - 1];
+                i--;
+            }
+            order[i] = c;
+        }
+        
+        memcpy(out, within, words * sizeof(uint64_t));
+        for (int i = 0; i < count; i++) {
+            uint64_t any = 0;
+            for (uint32_t w = 0; w < words; w++) any |= out[w];
+            if (!any) break;
+            
+            memset(scratch, 0, words * sizeof(uint64_t));
+            eval_query(q, order[i], out, scratch, words);
+            memcpy(out, scratch, words * sizeof(uint64_t));
+        }
+    }
+    free(scratch);
+}
+
+// Functions matching a query-language `query`; syntax errors go to
+// docs.search_error
+static void query_search(const char *query, result_set_t *set) {
+    set->count = 0;
+    set->complete = 1;
+    docs.search_error[0] = '\0';
+    
+    query_t *q = calloc(1, sizeof(query_t));
+    if (!q) return;
+    tokenize_query(query, q);
+    int root = q->token_count ? parse_query_or(q) : -1;
+    if (root >= 0 && q->pos < q->token_count) q->error = "Unexpected )";
+    if (q->error) {
+        snprintf(docs.search_error, sizeof(docs.search_error), "%s", q->error);
+        free(q);
+        return;
+    }
+    if (root < 0) {
+        free(q);
+        return;
+    }
+    
+    uint32_t words = (search_index.function_count + 63) / 64;
+    uint64_t *all = malloc((words ? words : 1) * sizeof(uint64_t));
+    uint64_t *found = calloc(words ? words : 1, sizeof(uint64_t));
+    if (all && found) {
+        memset(all, 0xff, words * sizeof(uint64_t));
+        if (search_index.function_count % 64) {
+            all[words - 1] = (1ULL << (search_index.function_count % 64)) - 1;
+        }
+        eval_query(q, root, all, found, words);
+        
+        for (uint32_t w = 0; w < words; w++) {
+            for (uint64_t bits = found[w]; bits; bits &= bits - 1) {
+                add_result(set, w * 64 + __builtin_ctzll(bits));
+            }
+        }
+    }
+    free(all);
+    free(found);
+    free(q);
+}
+
+// Live search keeps the results of every prefix of the query being typed:
+// levels[n] answers its first n characters. Typing a character narrows the
+// deepest complete level; backspace finds the shorter prefix still there.
+static struct {
+    char query[MAX_NAME_LENGTH];
+    int length;
+    result_set_t levels[MAX_NAME_LENGTH];
+    uint32_t generation;        // search_index.generation the levels came from
+} live;
+
+void live_search(const char *query) {
+    docs.search_count = 0;
+    docs.search_complete = 1;
+    docs.search_error[0] = '\0';
+    
+    if (!search_index.trigrams_valid) build_trigrams();
+    if (!search_index.trigrams_valid) return;
+    
+    // Nothing cached survives a change to the index
+    if (live.generation != search_index.generation) {
+        live.generation = search_index.generation;
+        live.length = 0;
+    }
+    
+    int len = strlen(query);
+    if (len >= MAX_NAME_LENGTH) len = MAX_NAME_LENGTH - 1;
+    
+    // Levels past the shared prefix describe some other query
+    int keep = 0;
+    while (keep < live.length && keep < len && live.query[keep] == query[keep]) keep++;
+    for (int n = keep + 1; n < MAX_NAME_LENGTH; n++) live.levels[n].valid = 0;
+    memcpy(live.query, query, len);
+    live.query[len] = '\0';
+    live.length = len;
+    if (len == 0) return;
+    
+    result_set_t *set = &live.levels[len];
+    if (!set->valid && live.query[0] == SEARCH_REGEX_PREFIX) {
+        // A longer pattern can match more, so there is nothing to narrow
+        regex_search(live.query + 1, set);
+        set->valid = docs.search_error[0] == '\0';
+        set->narrowable = 0;
+    } else if (!set->valid && is_structured_query(live.query)) {
+        // Likewise for operators: "a OR" becomes "a OR b"
+        query_search(live.query, set);
+        set->valid = docs.search_error[0] == '\0';
+        set->narrowable = 0;
+    } else if (!set->valid) {
+        // body: terms match whole identifiers, so a prefix's results don't
+        // contain a longer query's
+        int parent = strstr(live.query, SEARCH_BODY_PREFIX) ? 0 : len - 1;
+        while (parent > 0 && !(live.levels[parent].valid && live.levels[parent].complete &&
+                               live.levels[parent].narrowable)) parent--;
+        
+        // Checking strings is what costs; over a big pool, stop at a
+        // screenful rather than stall the keystroke
+        search_all(live.query, parent > 0 ? &live.levels[parent] : NULL, SEARCH_VERIFY_LIMIT, set);
+        set->valid = 1;
+        set->narrowable = 1;
+    }
+    publish_results(set);
+}
+
+// Run a partial live search to the end, once the user stops typing
+void finish_search() {
+    if (docs.search_complete || docs.search_source != SEARCH_QUERY || live.length == 0) return;
+    
+    result_set_t *set = &live.levels[live.length];
+    search_all(live.query, NULL, UINT32_MAX, set);
+    set->valid = 1;
+    publish_results(set);
+}
+
+void perform_search(const char *query) {
+    live.length = 0;
+    live_search(query);
+    if (!docs.search_editing) finish_search();
+}
+
+// Fuzzy finder
+//
+// fzf-style ranking: the query's characters must appear in order (ignoring
+// case) in the function name, or failing that in "path::name". A match
+// scores per character, with bonuses for landing on word boundaries,
+// camelCase humps and runs of consecutive characters, and penalties for
+// gaps. Matches within the name alone outrank path matches.
+//
+// Most functions are rejected by comparing folded-character masks before
+// any string is touched; survivors are scored in parallel chunks, each
+// keeping its best FUZZY_MAX_RESULTS in a min-heap, and the heaps are
+// merged at the end.
+#define FUZZY_MAX_RESULTS MAX_ITEMS
+#define FUZZY_CHUNK 16384           // functions per worker thread, at least
+
+#define SCORE_MATCH 16
+#define SCORE_GAP_START -3
+#define SCORE_GAP_EXTENSION -1
+#define BONUS_BOUNDARY 8
+#define BONUS_CAMEL 7
+#define BONUS_CONSECUTIVE 4
+#define BONUS_FIRST_CHAR 2          // multiplier for the first query character
+#define BONUS_NAME 8                // per query character, for name-only matches
+
+typedef struct {
+    int score;
+    int length;                     // shorter haystacks win ties
+    uint32_t ordinal;
+} fuzzy_hit_t;
+
+typedef struct {
+    fuzzy_hit_t hits[FUZZY_MAX_RESULTS];
+    int count;
+} fuzzy_heap_t;
+
+typedef struct {
+    const char *query;
+    int query_len;
+    uint64_t query_mask;
+    uint32_t begin, end;            // ordinal range
+    fuzzy_heap_t heap;
+} fuzzy_task_t;
+
+// Position of the first byte at or after `from` equal to `c` or its
+// uppercase form, or -1. `c` is lowercase.
+static int find_char(const char *s, int len, int from, unsigned char c) {
+#ifdef __SSE2__
+    __m128i lower = _mm_set1_epi8(c), upper = _mm_set1_epi8(toupper(c));
+    for (; from + 16 <= len; from += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(s + from));
+        int hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, lower),
+                                                  _mm_cmpeq_epi8(chunk, upper)));
+        if (hits) return from + __builtin_ctz(hits);
+    }
+#endif
+    for (; from < len; from++) {
+        if (tolower((unsigned char)s[from]) == c) return from;
+    }
+    return -1;
+}
+
+static int char_bonus(const char *s, int pos) {
+    if (pos == 0) return BONUS_BOUNDARY;
+    unsigned char prev = s[pos - 1], c = s[pos];
+    if (prev == '_' || prev == '/' || prev == '.' || prev == ':' || prev == '-') return BONUS_BOUNDARY;
+    if ((islower(prev) && isupper(c)) || (!isdigit(prev) && isdigit(c))) return BONUS_CAMEL;
+    return 0;
+}
+
+// Score of `query` against `s`, or -1 if it isn't a subsequence
+static int fuzzy_score(const char *s, int len, const char *query, int query_len) {
+    // Earliest point where the whole query has matched...
+    int end = 0;
+    for (int i = 0; i < query_len; i++) {
+        end = find_char(s, len, end, query[i]);
+        if (end < 0) return -1;
+        end++;
+    }
+    
+    // ...then walk back to the latest start, for the tightest window
+    int start = end;
+    for (int i = query_len - 1; i >= 0; i--) {
+        do start--; while (tolower((unsigned char)s[start]) != query[i]);
+    }
+    
+    int score = 0, matched = 0, consecutive = 0, in_gap = 0, chunk_bonus = 0;
+    for (int pos = start; pos < end; pos++) {
+        if (matched < query_len && tolower((unsigned char)s[pos]) == query[matched]) {
+            int bonus = char_bonus(s, pos);
+            if (consecutive) {
+                // A run keeps the bonus of the boundary it started on
+                if (bonus < chunk_bonus) bonus = chunk_bonus;
+                if (bonus < BONUS_CONSECUTIVE) bonus = BONUS_CONSECUTIVE;
+            } else {
+                chunk_bonus = bonus;
+            }
+            if (matched == 0) bonus *= BONUS_FIRST_CHAR;
+            score += SCORE_MATCH + bonus;
+            matched++;
+            consecutive = 1;
+            in_gap = 0;
+        } else {
+            score += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            consecutive = 0;
+            in_gap = 1;
+        }
+    }
+    return score;
+}
+
+static int fuzzy_better(const fuzzy_hit_t *a, const fuzzy_hit_t *b) {
+    if (a->score != b->score) return a->score > b->score;
+    if (a->length != b->length) return a->length < b->length;
+    return a->ordinal < b->ordinal;
+}
+
+// Min-heap on fuzzy_better(): the root is the weakest hit kept
+static void fuzzy_heap_push(fuzzy_heap_t *heap, fuzzy_hit_t hit) {
+    int i;
+    if (heap->count < FUZZY_MAX_RESULTS) {
+        i = heap->count++;
+        while (i > 0 && fuzzy_better(&heap->hits[(i - 1) / 2], &hit)) {
+            heap->hits[i] = heap->hits[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else {
+        if (!fuzzy_better(&hit, &heap->hits[0])) return;
+        i = 0;
+        while (1) {
+            int child = 2 * i + 1;
+            if (child >= heap->count) break;
+            if (child + 1 < heap->count && fuzzy_better(&heap->hits[child], &heap->hits[child + 1])) child++;
+            if (!fuzzy_better(&hit, &heap->hits[child])) break;
+            heap->hits[i] = heap->hits[child];
+            i = child;
+        }
+    }
+    heap->hits[i] = hit;
+}
+
+static void *fuzzy_worker(void *arg) {
+    fuzzy_task_t *task = arg;
+    fuzzy_heap_t *heap = &task->heap;
+    char haystack[MAX_PATH_LENGTH + MAX_NAME_LENGTH + 2];
+    int prefix_file = -1, prefix_len = 0, prefix_score = -1;
+    
+    // Nothing can beat every character landing on a word boundary
+    int best_possible = task->query_len * (SCORE_MATCH + BONUS_BOUNDARY + BONUS_NAME) +
+                        BONUS_BOUNDARY * (BONUS_FIRST_CHAR - 1);
+    
+    for (uint32_t ordinal = task->begin; ordinal < task->end; ordinal++) {
+        func_ref_t ref = search_index.refs[ordinal];
+        uint64_t name_mask = search_index.name_masks[ordinal];
+        if (task->query_mask & ~(name_mask | search_index.file_masks[ref.file])) continue;
+        
+        const char *name = search_index.names + search_index.name_offsets[ordinal];
+        int name_len = search_index.name_offsets[ordinal + 1] - search_index.name_offsets[ordinal] - 1;
+        
+        if (heap->count == FUZZY_MAX_RESULTS &&
+            (heap->hits[0].score > best_possible ||
+             (heap->hits[0].score == best_possible && heap->hits[0].length <= name_len))) continue;
+        
+        int score = -1;
+        if (!(task->query_mask & ~name_mask)) {
+            score = fuzzy_score(name, name_len, task->query, task->query_len);
+        }
+        if (score >= 0) {
+            score += BONUS_NAME * task->query_len;
+        } else {
+            // "path::" is shared by the whole file, so it is copied and
+            // scored once. A match that fits inside it scores the same for
+            // every function of the file.
+            if (prefix_file != (int)ref.file) {
+                prefix_len = snprintf(haystack, MAX_PATH_LENGTH, "%s::", str(docs.files[ref.file]->filename));
+                if (prefix_len >= MAX_PATH_LENGTH) prefix_len = MAX_PATH_LENGTH - 1;
+                prefix_score = fuzzy_score(haystack, prefix_len, task->query, task->query_len);
+                prefix_file = ref.file;
+            }
+            score = prefix_score;
+            if (score < 0) {
+                int len = name_len < MAX_NAME_LENGTH ? name_len : MAX_NAME_LENGTH;
+                memcpy(haystack + prefix_len, name, len);
+                score = fuzzy_score(haystack, prefix_len + len, task->query, task->query_len);
+                if (score < 0) continue;
+            }
+        }
+        fuzzy_heap_push(heap, (fuzzy_hit_t){ score, name_len, ordinal });
+    }
+    return NULL;
+}
+
+static int compare_hits(const void *a, const void *b) {
+    return fuzzy_better(b, a) - fuzzy_better(a, b);
+}
+
+// Best fuzzy matches for `term`, best first
+void fuzzy_search(const char *term) {
+    docs.search_count = 0;
+    docs.search_complete = 1;
+    
+    if (!search_index.valid) build_ordinals();
+    if (!search_index.valid) return;
+    
+    char query[MAX_NAME_LENGTH];
+    int query_len = 0;
+    for (const unsigned char *p = (const unsigned char *)term; *p && query_len < MAX_NAME_LENGTH - 1; p++) {
+        if (!isspace(*p)) query[query_len++] = tolower(*p);
+    }
+    query[query_len] = '\0';
+    if (query_len == 0) return;
+    
+    uint32_t total = search_index.function_count;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int task_count = total / FUZZY_CHUNK + 1;
+    if (task_count > cpus) task_count = cpus < 1 ? 1 : cpus;
+    if (task_count > MAX_SCAN_THREADS) task_count = MAX_SCAN_THREADS;
+    
+    fuzzy_task_t *tasks = calloc(task_count, sizeof(fuzzy_task_t));
+    pthread_t threads[MAX_SCAN_THREADS];
+    if (!tasks) return;
+    
+    uint64_t query_mask = char_mask(query);
+    for (int t = 0; t < task_count; t++) {
+        tasks[t].query = query;
+        tasks[t].query_len = query_len;
+        tasks[t].query_mask = query_mask;
+        tasks[t].begin = (uint64_t)total * t / task_count;
+        tasks[t].end = (uint64_t)total * (t + 1) / task_count;
+    }
+    
+    // The calling thread takes the first chunk itself
+    int started = 1;
+    for (; started < task_count; started++) {
+        if (pthread_create(&threads[started], NULL, fuzzy_worker, &tasks[started]) != 0) break;
+    }
+    fuzzy_worker(&tasks[0]);
+    for (int t = started; t < task_count; t++) fuzzy_worker(&tasks[t]);
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
+    
+    for (int t = 1; t < task_count; t++) {
+        for (int k = 0; k < tasks[t].heap.count; k++) fuzzy_heap_push(&tasks[0].heap, tasks[t].heap.hits[k]);
+    }
+    
+    fuzzy_heap_t *best = &tasks[0].heap;
+    qsort(best->hits, best->count, sizeof(fuzzy_hit_t), compare_hits);
+    if (grow_array((void **)&docs.search_results, &docs.search_capacity, best->count,
+                   sizeof(func_ref_t))) {
+        for (int k = 0; k < best->count; k++) {
+            docs.search_results[docs.search_count++] = search_index.refs[best->hits[k].ordinal];
+        }
+    }
+    free(tasks);
+}
+
+// List the functions named exactly `name`
+static void find_definitions(const char *name) {
+    uint32_t first, last;
+    docs.search_count = 0;
+    if (!find_names(name, 1, &first, &last) || first == last) return;
+    if (!grow_array((void **)&docs.search_results, &docs.search_capacity, last - first,
+                    sizeof(func_ref_t))) return;
+    for (uint32_t i = first; i < last; i++) {
+        docs.search_results[docs.search_count++] = search_index.refs[name_order.ordinals[i]];
+    }
+}
+
+// Re-run whichever search produced the current results
+void refresh_search() {
+    function_t *func;
+    switch (docs.search_source) {
+        case SEARCH_QUERY:
+            perform_search(docs.search_term);
+            break;
+        case SEARCH_FUZZY:
+            fuzzy_search(docs.search_term);
+            break;
+        case SEARCH_CALLERS:
+        case SEARCH_CALLEES:
+            func = find_function(docs.xref_file, docs.xref_name);
+            docs.search_count = 0;
+            if (func && docs.search_source == SEARCH_CALLERS) find_callers(func);
+            else if (func) find_callees(func);
+            break;
+        case SEARCH_DEFINITIONS:
+            find_definitions(docs.search_term);
+            break;
+    }
+}
+
+// List the callers or callees of func as search results
+void show_cross_references(function_t *func, search_source_t source) {
+    docs.search_source = source;
+    docs.xref_file = func->filename;
+    docs.xref_name = func->name;
+    snprintf(docs.search_term, sizeof(docs.search_term), "%s", str(func->name));
+    docs.search_complete = 1;
+    docs.search_editing = 0;
+    docs.search_stale = 0;
+    docs.search_error[0] = '\0';
+    refresh_search();
+    docs.current_selection = 0;
+    docs.state = STATE_SEARCH;
+}
+
+void find_undocumented_functions() {
+    docs.undocumented_count = 0;
+    
+    for (int i = 0; i < docs.file_count; i++) {
+        for (int j = 0; j < docs.files[i]->function_count; j++) {
+            function_t *func = &docs.files[i]->functions[j];
+            if (!func->is_documented) {
+                if (!grow_array((void **)&docs.undocumented_functions, &docs.undocumented_capacity,
+                                docs.undocumented_count + 1, sizeof(function_t *))) return;
+                docs.undocumented_functions[docs.undocumented_count++] = func;
+            }
+        }
+    }
+}
+
+// Watch mode
+//
+// A background thread keeps inotify watches on every scanned directory.
+// Events are collected until the tree has been quiet for WATCH_SETTLE_MS
+// (bounded by WATCH_MAX_DELAY_MS), so an editor save or a git checkout is
+// handled as one batch. Touched files are re-parsed on the watcher thread;
+// the finished records are handed to the main loop through wake_pipe and
+// swapped into docs.files there, so the UI never sees a half-applied update.
+static struct {
+    int requested;              // -w: start once the first scan has found the directories
+    int enabled;
+    int inotify_fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    file_update_t *updates;
+    int rescan_requested;
+    // Watch descriptor to directory mapping, also under `lock`: the watcher
+    // thread adds and forgets directories as events arrive, and the main
+    // loop adds the ones each rescan finds
+    int *wds;
+    char **wd_paths;
+    int wd_count;
+    int wd_capacity;
+} watch = { .inotify_fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+typedef struct {
+    char **paths;
+    int count;
+    int capacity;
+} path_list_t;
+
+static void path_list_add(path_list_t *list, char *path) {
+    if (!path) return;
+    if (!grow_array((void **)&list->paths, &list->capacity, list->count + 1, sizeof(char *))) {
+        free(path);
+        return;
+    }
+    list->paths[list->count++] = path;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// Called with watch.lock held
+static void watch_remember_dir(int wd, const char *dirpath) {
+    for (int i = 0; i < watch.wd_count; i++) {
+        if (watch.wds[i] == wd) return;  // already watched
+    }
+    if (watch.wd_count == watch.wd_capacity) {
+        int capacity = watch.wd_capacity ? watch.wd_capacity * 2 : 64;
+        int *wds = realloc(watch.wds, capacity * sizeof(int));
+        if (!wds) return;
+        watch.wds = wds;
+        char **paths = realloc(watch.wd_paths, capacity * sizeof(char *));
+        if (!paths) return;
+        watch.wd_paths = paths;
+        watch.wd_capacity = capacity;
+    }
+    char *copy = strdup(dirpath);
+    if (!copy) return;
+    watch.wds[watch.wd_count] = wd;
+    watch.wd_paths[watch.wd_count] = copy;
+    watch.wd_count++;
+}
+
+static void watch_add_dir(const char *dirpath) {
+    int wd = inotify_add_watch(watch.inotify_fd, dirpath,
+                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                               IN_CREATE | IN_DELETE | IN_ONLYDIR);
+    if (wd < 0) return;
+    
+    pthread_mutex_lock(&watch.lock);
+    watch_remember_dir(wd, dirpath);
+    pthread_mutex_unlock(&watch.lock);
+}
+
+// The path of a watched directory. Only the watcher thread forgets
+// directories, so the string stays valid for it without the lock.
+static const char *watch_dir_path(int wd) {
+    const char *path = NULL;
+    pthread_mutex_lock(&watch.lock);
+    for (int i = 0; i < watch.wd_count && !path; i++) {
+        if (watch.wds[i] == wd) path = watch.wd_paths[i];
+    }
+    pthread_mutex_unlock(&watch.lock);
+    return path;
+}
+
+static void watch_forget_dir(int wd) {
+    pthread_mutex_lock(&watch.lock);
+    for (int i = 0; i < watch.wd_count; i++) {
+        if (watch.wds[i] == wd) {
+            free(watch.wd_paths[i]);
+            watch.wd_count--;
+            watch.wds[i] = watch.wds[watch.wd_count];
+            watch.wd_paths[i] = watch.wd_paths[watch.wd_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&watch.lock);
+}
+
+// A directory appeared (mkdir, git checkout, mv): watch it and everything
+// below it, and queue the source files it already contains
+static void watch_add_tree(const char *dirpath, path_list_t *touched) {
+    DIR *dir = opendir(dirpath);
+    if (!dir) return;
+    watch_add_dir(dirpath);
+    
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        
+        char *path = join_path(dirpath, entry->d_name);
+        if (!path) continue;
+        
+        struct stat st;
+        if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            watch_add_tree(path, touched);
+            free(path);
+        } else if (is_c_file(entry->d_name)) {
+            path_list_add(touched, path);
+        } else {
+            free(path);
+        }
+    }
+    
+    closedir(dir);
+}
+
+// Returns 1 when a full rescan is needed
+static int watch_read_events(path_list_t *touched) {
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int rescan = 0;
+    
+    ssize_t len = read(watch.inotify_fd, buffer, sizeof(buffer));
+    if (len <= 0) return 0;
+    
+    for (char *p = buffer; p < buffer + len; ) {
+        struct inotify_event *event = (struct inotify_event *)p;
+        p += sizeof(struct inotify_event) + event->len;
+        
+        if (event->mask & IN_Q_OVERFLOW) {
+            rescan = 1;
+            continue;
+        }
+        if (event->mask & IN_IGNORED) {
+            watch_forget_dir(event->wd);
+            continue;
+        }
+        
+        const char *dirpath = watch_dir_path(event->wd);
+        if (!dirpath || event->len == 0 || event->name[0] == '.') continue;
+        
+        if (event->mask & IN_ISDIR) {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                char *path = join_path(dirpath, event->name);
+                if (path) watch_add_tree(path, touched);
+                free(path);
+            } else {
+                // A directory went away with its files; let a rescan sort it out
+                rescan = 1;
+            }
+        } else if (is_c_file(event->name)) {
+            path_list_add(touched, join_path(dirpath, event->name));
+        }
+    }
+    
+    return rescan;
+}
+
+static void watch_publish(path_list_t *touched, int rescan) {
+    // Save storms touch the same file many times; parse each path once
+    qsort(touched->paths, touched->count, sizeof(char *), compare_strings);
+    
+    file_update_t *updates = NULL;
+    for (int i = 0; i < touched->count; i++) {
+        char *path = touched->paths[i];
+        if (i > 0 && strcmp(path, touched->paths[i - 1]) == 0) {
+            free(path);
+            continue;
+        }
+        
+        file_update_t *update = calloc(1, sizeof(file_update_t));
+        if (!update) {
+            free(path);
+            continue;
+        }
+        update->path = path;
+        update->file = new_source_file(path);
+        if (update->file) {
+            parse_c_file(path, update->file, NULL);
+            if (update->file->function_count == 0) {
+                free_source_file(update->file);
+                update->file = NULL;
+            }
+        }
+        update->next = updates;
+        updates = update;
+    }
+    touched->count = 0;
+    
+    if (!updates && !rescan) return;
+    
+    pthread_mutex_lock(&watch.lock);
+    file_update_t **tail = &updates;
+    while (*tail) tail = &(*tail)->next;
+    *tail = watch.updates;
+    watch.updates = updates;
+    watch.rescan_requested |= rescan;
+    pthread_mutex_unlock(&watch.lock);
+    
+    wake_main_loop();
+}
+
+static void *watch_thread(void *arg) {
+    (void)arg;
+    path_list_t touched = { 0 };
+    struct pollfd pfd = { .fd = watch.inotify_fd, .events = POLLIN };
+    
+    while (1) {
+        if (poll(&pfd, 1, -1) <= 0) continue;
+        
+        int rescan = watch_read_events(&touched);
+        
+        // Coalesce the rest of the burst
+        struct timespec start, now;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (poll(&pfd, 1, WATCH_SETTLE_MS) > 0) {
+            rescan |= watch_read_events(&touched);
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 +
+                              (now.tv_nsec - start.tv_nsec) / 1000000;
+            if (elapsed_ms >= WATCH_MAX_DELAY_MS) break;
+        }
+        
+        watch_publish(&touched, rescan);
+    }
+    
+    return NULL;
+}
+
+int start_watching() {
+    watch.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch.inotify_fd < 0) return 0;
+    
+    watch_add_dir(".");
+    for (int i = 0; i < scan.dir_count; i++) {
+        watch_add_dir(scan.dirs[i]);
+    }
+    
+    if (pthread_create(&watch.thread, NULL, watch_thread, NULL) != 0) {
+        close(watch.inotify_fd);
+        watch.inotify_fd = -1;
+        return 0;
+    }
+    
+    watch.enabled = 1;
+    return 1;
+}
+
+static void free_file_updates(file_update_t *updates) {
+    while (updates) {
+        file_update_t *next = updates->next;
+        free_source_file(updates->file);
+        free(updates->path);
+        free(updates);
+        updates = next;
+    }
+}
+
+typedef struct {
+    file_update_t *update;
+    int order;                  // position in the list, the earlier one wins
+} ranked_update_t;
+
+static int compare_updates(const void *a, const void *b) {
+    const ranked_update_t *x = a, *y = b;
+    int cmp = strcmp(x->update->path, y->update->path);
+    return cmp ? cmp : x->order - y->order;
+}
+
+// Swap a batch of re-parsed files into the sorted file list. Known files are
+// replaced or removed in place and new ones merged in a single pass, so a
+// scan streaming in thousands of files doesn't shift the list once per
+// file. If a path comes more than once the first update wins. Consumes the
+// list; returns the number of files that were not known before.
+static int apply_file_updates(file_update_t *updates) {
+    int count = 0;
+    for (file_update_t *u = updates; u; u = u->next) count++;
+    if (count == 0) return 0;
+    
+    ranked_update_t *batch = malloc(count * sizeof(ranked_update_t));
+    source_file_t **gone = malloc(count * sizeof(source_file_t *));
+    if (!batch || !gone) {
+        free(batch);
+        free(gone);
+        free_file_updates(updates);
+        return 0;
+    }
+    count = 0;
+    for (file_update_t *u = updates; u; u = u->next, count++) {
+        batch[count] = (ranked_update_t){ u, count };
+    }
+    qsort(batch, count, sizeof(ranked_update_t), compare_updates);
+    invalidate_indexes();
+    
+    // New files collect at the front of `batch`, still sorted
+    int inserts = 0, gone_count = 0;
+    const char *previous_path = NULL;
+    for (int i = 0; i < count; i++) {
+        file_update_t *update = batch[i].update;
+        if (previous_path && strcmp(update->path, previous_path) == 0) continue;
+        previous_path = update->path;
+        
+        int index = find_file_index(update->path);
+        if (index < 0) {
+            if (update->file) batch[inserts++].update = update;
+            continue;
+        }
+        
+        source_file_t *old = docs.files[index];
+        count_coverage(old, -1);
+        if (update->file) {
+            carry_over_documentation(old, update->file);
+            count_coverage(update->file, 1);
+            docs.files[index] = update->file;
+            update->file = NULL;
+            retire_source_file(old);
+        } else {
+            gone[gone_count++] = old;  // dropped below, in path order
+        }
+    }
+    
+    if (gone_count > 0) {
+        int kept = 0;
+        for (int i = 0, g = 0; i < docs.file_count; i++) {
+            if (g < gone_count && docs.files[i] == gone[g]) {
+                retire_source_file(gone[g++]);
+            } else {
+                docs.files[kept++] = docs.files[i];
+            }
+        }
+        docs.file_count = kept;
+    }
+    
+    // Merge from the back, so nothing is moved twice
+    int added = 0;
+    if (inserts > 0 && grow_array((void **)&docs.files, &docs.file_capacity, docs.file_count + inserts,
+                                  sizeof(source_file_t *))) {
+        int i = docs.file_count - 1, k = docs.file_count + inserts - 1;
+        for (int j = inserts - 1; j >= 0; k--) {
+            source_file_t *file = batch[j].update->file;
+            if (i >= 0 && strcmp(str(docs.files[i]->filename), str(file->filename)) > 0) {
+                docs.files[k] = docs.files[i--];
+            } else {
+                docs.files[k] = file;
+                batch[j--].update->file = NULL;
+                count_coverage(file, 1);
+            }
+        }
+        docs.file_count += inserts;
+        added = inserts;
+    }
+    
+    free(batch);
+    free(gone);
+    free_file_updates(updates);  // only the records that weren't used are left
+    return added;
+}
+
+static void clamp_selection(int count) {
+    if (docs.current_selection >= count) docs.current_selection = count - 1;
+    if (docs.current_selection < 0) docs.current_selection = 0;
+}
+
+typedef enum {
+    KEY_NONE,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_RIGHT,
+    KEY_LEFT,
+    KEY_HOME,
+    KEY_END,
+    KEY_PAGE_UP,
+    KEY_PAGE_DOWN
+} nav_key_t;
+
+// Read the rest of an escape sequence once ESC has been read: a letter for
+// the arrows (and HOME/END on some terminals), "n~" for the editing keys
+static nav_key_t read_escape_key() {
+    int c = getchar();
+    if (c != '[' && c != 'O') return KEY_NONE;
+    
+    int n = 0;
+    c = getchar();
+    while (isdigit(c) || c == ';') {
+        n = c == ';' ? 0 : n * 10 + c - '0';  // keep the last parameter
+        c = getchar();
+    }
+    
+    switch (c) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return KEY_RIGHT;
+        case 'D': return KEY_LEFT;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+        case '~':
+            switch (n) {
+                case 1: case 7: return KEY_HOME;
+                case 4: case 8: return KEY_END;
+                case 5: return KEY_PAGE_UP;
+                case 6: return KEY_PAGE_DOWN;
+            }
+    }
+    return KEY_NONE;
+}
+
+// Move the selection in a list of `count` rows. A page moves the view and
+// the selection together, by what the last frame showed.
+static void move_selection(nav_key_t key, int count) {
+    int page = docs.list_rows > 0 ? docs.list_rows : 1;
+    switch (key) {
+        case KEY_UP: docs.current_selection--; break;
+        case KEY_DOWN: docs.current_selection++; break;
+        case KEY_HOME: docs.current_selection = 0; break;
+        case KEY_END: docs.current_selection = count - 1; break;
+        case KEY_PAGE_UP:
+            docs.current_selection -= page;
+            docs.list_top -= page;
+            break;
+        case KEY_PAGE_DOWN:
+            docs.current_selection += page;
+            docs.list_top += page;
+            break;
+        default: return;
+    }
+    clamp_selection(count);
+}
+
+// Whether `file` was listed when the scan started but the scan didn't find it
+static int scan_dropped(const source_file_t *file) {
+    int index = search_files(scan.previous, scan.previous_count, str(file->filename));
+    return index >= 0 && scan.previous[index] == file &&
+           !bsearch(&file->filename, scan.seen, scan.seen_count, sizeof(str_id_t), compare_paths);
+}
+
+// Called from the main loop once the scan's workers are through: drop the
+// files the scan didn't find again, load documentation for the new ones and
+// start watching if that was asked for
+static void finish_scan() {
+    if (scan.threaded) pthread_join(scan.thread, NULL);
+    scan.running = 0;
+    scan.cancelled = scan.cancel;
+    
+    // Only records from the snapshot can be stale; what the watcher added
+    // meanwhile wasn't there to be found. Stale records go to the retired
+    // list, and nothing is freed or moved before the index builder, which
+    // walks docs.files, has been stopped.
+    int dropped = 0;
+    for (int i = 0; i < docs.file_count && !scan.cancelled; i++) {
+        if (scan_dropped(docs.files[i])) dropped++;
+    }
+    if (dropped > 0) {
+        invalidate_indexes();
+        int kept = 0;
+        for (int i = 0; i < docs.file_count; i++) {
+            source_file_t *file = docs.files[i];
+            if (!scan_dropped(file)) {
+                docs.files[kept++] = file;
+                continue;
+            }
+            count_coverage(file, -1);
+            if (grow_array((void **)&scan.retired, &scan.retired_capacity, scan.retired_count + 1,
+                           sizeof(source_file_t *))) {
+                scan.retired[scan.retired_count++] = file;
+            }
+        }
+        docs.file_count = kept;
+    }
     
-    // Go backwards from ( to find function name
-    char *start = paren - 1;
-    while (start > signature && (isalnum(*start) || *start == '_')) {
-        start--;
+    for (int i = 0; i < scan.retired_count; i++) {
+        free_source_file(scan.retired[i]);
     }
-    start++; // Move to first character of name
+    scan.retired_count = 0;
+    int expected = scan.previous_count ? scan.previous_count : scan.cached_count;
+    scan.previous_count = 0;
     
-    // Skip if no valid name found
-    if (start >= paren) return 0;
+    if (scan.new_files > 0) load_documentation();
+    if (scan.cancelled) return;
     
-    int len = paren - start;
-    if (len >= MAX_NAME_LENGTH) len = MAX_NAME_LENGTH - 1;
+    // A cancelled scan's list is partial, so only a full one replaces it
+    file_stamp_t *empty = scan.empty;
+    int empty_capacity = scan.empty_capacity;
+    scan.empty = scan.found_empty;
+    scan.empty_count = scan.found_empty_count;
+    scan.empty_capacity = scan.found_empty_capacity;
+    scan.found_empty = empty;
+    scan.found_empty_capacity = empty_capacity;
+    scan.found_empty_count = 0;
     
-    strncpy(name, start, len);
-    name[len] = '\0';
+    docs.complete = 1;
+    save_pending_documentation();
+    if (scan.changed_files > 0 || scan.seen_count != expected) save_cache();
+    
+    if (watch.requested && !watch.enabled) {
+        if (!start_watching()) {
+            perror("Failed to start watching project files");
+            exit(1);
+        }
+    } else if (watch.enabled) {
+        // A rescan can find directories no event told the watcher about
+        for (int i = 0; i < scan.dir_count; i++) {
+            watch_add_dir(scan.dirs[i]);
+        }
+    }
     
-    return strlen(name) > 0;
+    // The scan that just ended may have read the directories concerned
+    // before the changes that made the watcher ask for another
+    if (scan.rescan_pending) start_scan();
 }
 
-int is_function_line(const char *line, const char *filename) {
-    // Skip obvious non-function lines
-    if (strstr(line, "//") == line) return 0;  // Comment
-    if (strstr(line, "/*") == line) return 0;  // Comment
-    if (strstr(line, "#") == line) return 0;   // Preprocessor
-    if (strstr(line, "typedef") == line) return 0;
-    if (strstr(line, "struct") == line) return 0;
-    if (strstr(line, "enum") == line) return 0;
-    if (strstr(line, "union") == line) return 0;
-    
-    // Must contain parentheses
-    if (!strchr(line, '(') || !strchr(line, ')')) return 0;
-    
-    // Skip function calls (likely indented)
-    if (line[0] == ' ' || line[0] == '\t') return 0;
+// Called from the main loop when a worker has woken it, and every
+// SCAN_REFRESH_MS while a scan runs
+void apply_updates() {
+    char drain[64];
+    while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
     
-    char *trimmed = strdup(line);
-    if (!trimmed) return 0;
+    pthread_mutex_lock(&watch.lock);
+    file_update_t *updates = watch.updates;
+    int rescan = watch.rescan_requested;
+    watch.updates = NULL;
+    watch.rescan_requested = 0;
+    pthread_mutex_unlock(&watch.lock);
     
-    trim_whitespace(trimmed);
+    pthread_mutex_lock(&scan.lock);
+    file_update_t *scanned = scan.updates;
+    int scan_done = scan.running && scan.done;
+    scan.updates = NULL;
+    pthread_mutex_unlock(&scan.lock);
     
-    // For .h files, accept both declarations (ending with ;) and definitions
-    int len = strlen(filename);
-    int is_header = (len > 2 && strcmp(filename + len - 2, ".h") == 0);
+    // Nothing but progress to show
+    if (!updates && !scanned && !rescan && !scan_done) return;
     
-    int is_valid = 0;
-    if (is_header) {
-        // In headers, accept both declarations and definitions
-        is_valid = (strlen(trimmed) > 0);
-    } else {
-        // In .c files, only accept definitions (not ending with semicolon)
-        is_valid = (strlen(trimmed) > 0 && trimmed[strlen(trimmed)-1] != ';');
+    // Remember what is on screen by name, since indices shift under us
+    str_id_t current_path = NO_STRING;
+    str_id_t current_name = NO_STRING;
+    if (docs.state == STATE_FILES && docs.current_selection < docs.file_count) {
+        current_path = docs.files[docs.current_selection]->filename;
+    } else if ((docs.state == STATE_FUNCTIONS || docs.state == STATE_FUNCTION_DETAIL) &&
+        docs.current_file < docs.file_count) {
+        source_file_t *file = docs.files[docs.current_file];
+        current_path = file->filename;
+        if (docs.current_function < file->function_count) {
+            current_name = file->functions[docs.current_function].name;
+        }
     }
     
-    free(trimmed);
-    return is_valid;
-}
-
-void parse_c_file(const char *filepath, source_file_t *file) {
-    FILE *f = fopen(filepath, "r");
-    if (!f) return;
-    
-    char line[MAX_LINE_LENGTH];
-    int line_num = 0;
-    file->function_count = 0;
+    // The scanner may have read a file before the edit the watcher has
+    // just parsed, so its batch goes in first and the watcher's wins
+    int watched = updates != NULL;
+    scan.new_files += apply_file_updates(scanned);
+    int new_files = apply_file_updates(updates);
+    if (scan_done) finish_scan();
+    if (rescan && scan.running) {
+        scan.rescan_pending = 1;
+    } else if (rescan) {
+        start_scan();
+    }
+    if (new_files > 0) load_documentation();
+    if (watched && !scan.running) save_cache();
     
-    while (fgets(line, sizeof(line), f) && file->function_count < MAX_ITEMS) {
-        line_num++;
-        trim_whitespace(line);
-        
-        if (is_function_line(line, filepath)) {
-            function_t *func = &file->functions[file->function_count];
-            
-            // Initialize the entire function structure to zero
-            memset(func, 0, sizeof(function_t));
-            
-            // Store signature
-            strncpy(func->signature, line, MAX_NAME_LENGTH - 1);
-            func->signature[MAX_NAME_LENGTH - 1] = '\0';
+    switch (docs.state) {
+        case STATE_FILES:
+            if (current_path != NO_STRING) {
+                int index = find_file_index(str(current_path));
+                docs.current_selection = index >= 0 ? index : -index - 1;
+            }
+            clamp_selection(docs.file_count);
+            break;
+        case STATE_FUNCTIONS:
+        case STATE_FUNCTION_DETAIL: {
+            int index = current_path == NO_STRING ? -1 : find_file_index(str(current_path));
+            if (index < 0) {
+                docs.state = STATE_FILES;
+                docs.current_selection = 0;
+                break;
+            }
+            source_file_t *file = docs.files[index];
+            docs.current_file = index;
             
-            // Extract function name
-            if (extract_function_name(line, func->name)) {
-                strncpy(func->filename, file->filename, MAX_PATH_LENGTH - 1);
-                func->filename[MAX_PATH_LENGTH - 1] = '\0';
-                func->line_number = line_num;
-                func->is_documented = 0;
-                
-                // Only extract return type (parameter parsing removed)
-                extract_return_type(line, func->return_type);
-                
-                // Initialize documentation fields
-                strcpy(func->description, "");
-                strcpy(func->parameters, "");
-                strcpy(func->return_value, "");
-                strcpy(func->example, "");
-                strcpy(func->notes, "");
-                
-                file->function_count++;
+            if (docs.state == STATE_FUNCTION_DETAIL) {
+                int found = -1;
+                for (int i = 0; i < file->function_count; i++) {
+                    if (file->functions[i].name == current_name) {
+                        found = i;
+                        break;
+                    }
+                }
+                if (found >= 0) {
+                    docs.current_function = found;
+                } else {
+                    docs.state = STATE_FUNCTIONS;
+                    docs.current_selection = docs.current_function;
+                }
             }
+            clamp_selection(file->function_count);
+            break;
         }
+        case STATE_SEARCH:
+            refresh_search();
+            clamp_selection(docs.search_count);
+            break;
+        case STATE_UNDOCUMENTED:
+            find_undocumented_functions();
+            clamp_selection(docs.undocumented_count);
+            break;
     }
-    
-    fclose(f);
 }
 
-void scan_project_files() {
-    DIR *dir = opendir(".");
-    if (!dir) return;
-    
-    struct dirent *entry;
-    docs.file_count = 0;
+// Block until a key is available. Returns 0 instead if a worker woke us
+// first, or when it's time to show a running scan's progress.
+int wait_for_key() {
+    struct pollfd fds[2] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = wake_pipe[0], .events = POLLIN },
+    };
+    while (poll(fds, 2, scan.running ? SCAN_REFRESH_MS : -1) < 0) {}
     
-    while ((entry = readdir(dir)) != NULL && docs.file_count < MAX_ITEMS) {
-        if (is_c_file(entry->d_name)) {
-            source_file_t *file = &docs.files[docs.file_count];
-            strncpy(file->filename, entry->d_name, MAX_PATH_LENGTH - 1);
-            file->filename[MAX_PATH_LENGTH - 1] = '\0';
-            strncpy(file->full_path, entry->d_name, MAX_PATH_LENGTH - 1);
-            file->full_path[MAX_PATH_LENGTH - 1] = '\0';
-            
-            parse_c_file(entry->d_name, file);
-            
-            if (file->function_count > 0) {
-                docs.file_count++;
-            }
-        }
+    return fds[0].revents != 0;
+}
+
+// Screen rendering
+//
+// Views print as they always have, but between begin_frame() and
+// end_frame() stdout is an in-memory stream. end_frame() lays the text out
+// on a grid of cells, wrapping long lines like the terminal would and
+// keeping the bottom rows if the text is taller than the screen, compares
+// it with the previous frame and sends only the cells that changed, with
+// cursor moves, in one write(). Only the SGR colours this program uses are
+// tracked.
+#define ATTR_BOLD 0x10
+
+// Outside frames stdout goes through here, so that a message or prompt
+// printed over a view makes the next frame redraw in full
+static ssize_t console_write(void *cookie, const char *data, size_t size) {
+    (void)cookie;
+    screen.front_valid = 0;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(STDOUT_FILENO, data + written, size - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return written ? (ssize_t)written : -1;
+        written += n;
     }
-    
-    closedir(dir);
+    return written;
 }
 
-// Documentation persistence
-void save_documentation() {
-    FILE *f = fopen(DOCS_FILE, "w");
-    if (!f) return;
-    
-    fprintf(f, "# Project Documentation\n");
-    fprintf(f, "# Auto-generated - do not edit the function signatures\n\n");
+void init_screen() {
+    if (!isatty(STDOUT_FILENO)) return;
+    FILE *console = fopencookie(NULL, "w", (cookie_io_functions_t){ .write = console_write });
+    if (!console) return;
+    setvbuf(console, NULL, _IOLBF, BUFSIZ);
+    fflush(stdout);
+    stdout = console;
+}
+
+void terminal_size(int *rows, int *cols) {
+    struct winsize ws;
+    *rows = 24;
+    *cols = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+    }
+}
+
+void begin_frame() {
+    fflush(stdout);
+    screen.stream = open_memstream(&screen.text, &screen.text_size);
+    if (!screen.stream) return;
+    screen.terminal = stdout;
+    stdout = screen.stream;
+}
+
+static void frame_append(const char *data, size_t len) {
+    if (!grow_array((void **)&screen.out, &screen.out_capacity, screen.out_size + len, 1)) return;
+    memcpy(screen.out + screen.out_size, data, len);
+    screen.out_size += len;
+}
+
+static void frame_printf(const char *format, int a, int b) {
+    char buffer[32];
+    int len = snprintf(buffer, sizeof(buffer), format, a, b);
+    frame_append(buffer, len);
+}
+
+// Apply the parameters of an SGR sequence to `attr`
+static uint8_t apply_sgr(uint8_t attr, const char *params, const char *end) {
+    if (params == end) return 0;
+    while (params < end) {
+        int n = 0;
+        while (params < end && isdigit((unsigned char)*params)) n = n * 10 + *params++ - '0';
+        if (params < end) params++;  // ';'
+        if (n == 0) attr = 0;
+        else if (n == 1) attr |= ATTR_BOLD;
+        else if (n == 22) attr &= ~ATTR_BOLD;
+        else if (n >= 30 && n <= 37) attr = (attr & ATTR_BOLD) | (n - 29);
+        else if (n == 39) attr &= ATTR_BOLD;
+    }
+    return attr;
+}
+
+// Whether a UTF-8 character takes two columns: CJK and emoji
+static int wide_character(const unsigned char *p, int len) {
+    uint32_t cp;
+    if (len == 3) cp = (p[0] & 0x0f) << 12 | (p[1] & 0x3f) << 6 | (p[2] & 0x3f);
+    else if (len == 4) cp = (p[0] & 0x07) << 18 | (p[1] & 0x3f) << 12 | (p[2] & 0x3f) << 6 | (p[3] & 0x3f);
+    else return 0;
+    return (cp >= 0x1100 && cp <= 0x115f) || (cp >= 0x2e80 && cp <= 0xa4cf) ||
+           (cp >= 0xac00 && cp <= 0xd7a3) || (cp >= 0xf900 && cp <= 0xfaff) ||
+           (cp >= 0xff00 && cp <= 0xff60) || (cp >= 0xffe0 && cp <= 0xffe6) ||
+           (cp >= 0x1f300 && cp <= 0x1faff) || (cp >= 0x20000 && cp <= 0x3fffd);
+}
+
+// Lay the frame's text out on `cells` (rows * cols, blank), returning the
+// row and column the text ended at. Rows scrolled off the top are dropped.
+// With no cells the text is only measured, without scrolling.
+static void layout_frame(const char *text, size_t size, cell_t *cells, int rows, int cols,
+                         int *end_row, int *end_col) {
+    int row = 0, col = 0, top = 0;  // top: text row shown on the first screen row
+    uint8_t attr = 0;
+    const char *p = text, *end = text + size;
     
-    for (int i = 0; i < docs.file_count; i++) {
-        source_file_t *file = &docs.files[i];
-        for (int j = 0; j < file->function_count; j++) {
-            function_t *func = &file->functions[j];
-            if (func->is_documented) {
-                fprintf(f, "FUNCTION: %s\n", func->name);
-                fprintf(f, "FILE: %s\n", func->filename);
-                fprintf(f, "LINE: %d\n", func->line_number);
-                fprintf(f, "SIGNATURE: %s\n", func->signature);
-                fprintf(f, "DESCRIPTION: %s\n", func->description);
-                fprintf(f, "PARAMETERS: %s\n", func->parameters);
-                fprintf(f, "RETURN: %s\n", func->return_value);
-                fprintf(f, "EXAMPLE: %s\n", func->example);
-                fprintf(f, "NOTES: %s\n", func->notes);
-                fprintf(f, "---\n");
+    while (p < end) {
+        unsigned char c = *p;
+        if (c == '\033' && p + 1 < end && p[1] == '[') {
+            const char *params = p + 2, *q = params;
+            while (q < end && !isalpha((unsigned char)*q)) q++;
+            if (q < end && *q == 'm') attr = apply_sgr(attr, params, q);
+            p = q + 1;
+            continue;
+        }
+        if (c == '\n' || col == cols) {
+            row++;
+            col = 0;
+            if (cells && row - top == rows) {
+                // Scroll: what was on screen moves up a row
+                memmove(cells, cells + cols, (size_t)(rows - 1) * cols * sizeof(cell_t));
+                for (int i = 0; i < cols; i++) cells[(rows - 1) * cols + i] = (cell_t){ " ", 0 };
+                top++;
+            }
+            if (c == '\n') {
+                p++;
+                continue;
             }
         }
+        if (c == '\r') {
+            col = 0;
+            p++;
+            continue;
+        }
+        if (c == '\t') {
+            int stop = (col / 8 + 1) * 8;
+            while (col < stop && col < cols) {
+                if (cells) cells[(row - top) * cols + col] = (cell_t){ " ", attr };
+                col++;
+            }
+            p++;
+            continue;
+        }
+        
+        int len = c < 0x80 ? 1 : c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+        if (len > end - p) len = end - p;
+        if (c < ' ' && len == 1) {
+            p++;
+            continue;
+        }
+        int wide = wide_character((const unsigned char *)p, len) && cols > 1;
+        if (wide && col == cols - 1) {
+            // Doesn't fit: the terminal wraps it to the next row
+            if (cells) cells[(row - top) * cols + col] = (cell_t){ " ", attr };
+            col++;
+            continue;
+        }
+        if (cells) {
+            cell_t *cell = &cells[(row - top) * cols + col];
+            memset(cell->text, 0, sizeof(cell->text));
+            memcpy(cell->text, p, len);
+            cell->attr = attr;
+            // The second column of a wide character is covered by it, text ""
+            if (wide) cells[(row - top) * cols + col + 1] = (cell_t){ "", attr };
+        }
+        col += 1 + wide;
+        p += len;
     }
-    
-    fclose(f);
+    *end_row = row - top;
+    *end_col = col < cols ? col : cols - 1;
 }
 
-void load_documentation() {
-    FILE *f = fopen(DOCS_FILE, "r");
-    if (!f) return;
+static void emit_attr(uint8_t attr) {
+    frame_append("\033[0m", 4);
+    if (attr & ATTR_BOLD) frame_append("\033[1m", 4);
+    if (attr & 0x0f) frame_printf("\033[%dm", 29 + (attr & 0x0f), 0);
+}
+
+void end_frame() {
+    if (!screen.stream) return;
+    fclose(screen.stream);
+    screen.stream = NULL;
+    stdout = screen.terminal;
+    
+    int rows, cols;
+    terminal_size(&rows, &cols);
+    if (rows != screen.rows || cols != screen.cols) {
+        free(screen.front);
+        free(screen.back);
+        screen.front = malloc((size_t)rows * cols * sizeof(cell_t));
+        screen.back = malloc((size_t)rows * cols * sizeof(cell_t));
+        screen.rows = screen.front && screen.back ? rows : 0;
+        screen.cols = screen.front && screen.back ? cols : 0;
+        screen.front_valid = 0;
+    }
+    if (!screen.rows) {
+        // No memory for cells: print the frame as it is
+        fputs("\033[2J\033[H", stdout);
+        fwrite(screen.text, 1, screen.text_size, stdout);
+        fflush(stdout);
+        free(screen.text);
+        screen.text = NULL;
+        return;
+    }
     
-    char line[MAX_LINE_LENGTH];
-    char current_func_name[MAX_NAME_LENGTH] = "";
-    char current_filename[MAX_PATH_LENGTH] = "";
+    cell_t blank = { " ", 0 };
+    for (int i = 0; i < rows * cols; i++) screen.back[i] = blank;
+    int end_row, end_col;
+    layout_frame(screen.text, screen.text_size, screen.back, rows, cols, &end_row, &end_col);
+    free(screen.text);
+    screen.text = NULL;
     
-    while (fgets(line, sizeof(line), f)) {
-        trim_whitespace(line);
-        
-        if (strncmp(line, "FUNCTION: ", 10) == 0) {
-            strncpy(current_func_name, line + 10, MAX_NAME_LENGTH - 1);
-            current_func_name[MAX_NAME_LENGTH - 1] = '\0';
-        } else if (strncmp(line, "FILE: ", 6) == 0) {
-            strncpy(current_filename, line + 6, MAX_PATH_LENGTH - 1);
-            current_filename[MAX_PATH_LENGTH - 1] = '\0';
-        } else if (strlen(current_func_name) > 0 && strlen(current_filename) > 0) {
-            // Find the function in our parsed data
-            function_t *func = NULL;
-            for (int i = 0; i < docs.file_count; i++) {
-                if (strcmp(docs.files[i].filename, current_filename) == 0) {
-                    for (int j = 0; j < docs.files[i].function_count; j++) {
-                        if (strcmp(docs.files[i].functions[j].name, current_func_name) == 0) {
-                            func = &docs.files[i].functions[j];
-                            break;
-                        }
-                    }
-                    break;
-                }
-            }
+    // Hide the cursor while drawing; a cleared screen is all blanks
+    screen.out_size = 0;
+    frame_append("\033[?25l", 6);
+    if (!screen.front_valid) {
+        frame_append("\033[0m\033[2J", 8);
+        for (int i = 0; i < rows * cols; i++) screen.front[i] = blank;
+        screen.front_valid = 1;
+    }
+    
+    int cursor_row = -1, cursor_col = -1;
+    int attr = -1;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            cell_t *back = &screen.back[r * cols + c];
+            cell_t *front = &screen.front[r * cols + c];
+            if (memcmp(back, front, sizeof(cell_t)) == 0) continue;
             
-            if (func) {
-                if (strncmp(line, "DESCRIPTION: ", 13) == 0) {
-                    strncpy(func->description, line + 13, MAX_CONTENT_LENGTH - 1);
-                    func->description[MAX_CONTENT_LENGTH - 1] = '\0';
-                    func->is_documented = 1;
-                } else if (strncmp(line, "PARAMETERS: ", 12) == 0) {
-                    strncpy(func->parameters, line + 12, MAX_CONTENT_LENGTH - 1);
-                    func->parameters[MAX_CONTENT_LENGTH - 1] = '\0';
-                } else if (strncmp(line, "RETURN: ", 8) == 0) {
-                    strncpy(func->return_value, line + 8, MAX_CONTENT_LENGTH - 1);
-                    func->return_value[MAX_CONTENT_LENGTH - 1] = '\0';
-                } else if (strncmp(line, "EXAMPLE: ", 9) == 0) {
-                    strncpy(func->example, line + 9, MAX_CONTENT_LENGTH - 1);
-                    func->example[MAX_CONTENT_LENGTH - 1] = '\0';
-                } else if (strncmp(line, "NOTES: ", 7) == 0) {
-                    strncpy(func->notes, line + 7, MAX_CONTENT_LENGTH - 1);
-                    func->notes[MAX_CONTENT_LENGTH - 1] = '\0';
-                } else if (strcmp(line, "---") == 0) {
-                    strcpy(current_func_name, "");
-                    strcpy(current_filename, "");
-                }
+            if (r != cursor_row || c != cursor_col) frame_printf("\033[%d;%dH", r + 1, c + 1);
+            if (back->attr != attr) {
+                emit_attr(back->attr);
+                attr = back->attr;
+            }
+            *front = *back;
+            if (!back->text[0]) continue;  // drawn with the wide character before it
+            frame_append(back->text, strnlen(back->text, sizeof(back->text)));
+            cursor_row = r;
+            cursor_col = c + 1;
+            if (c + 1 < cols && !screen.back[r * cols + c + 1].text[0]) {
+                screen.front[r * cols + c + 1] = screen.back[r * cols + c + 1];
+                cursor_col = c + 2;
+                c++;
             }
         }
     }
     
-    fclose(f);
-}
-
-// Search and filter functions
-void perform_search(const char *term) {
-    docs.search_count = 0;
+    // Leave the cursor where the text ended, for prompts printed after a view
+    frame_append("\033[0m", 4);
+    frame_printf("\033[%d;%dH", end_row + 1, end_col + 1);
+    frame_append("\033[?25h", 6);
     
-    for (int i = 0; i < docs.file_count; i++) {
-        for (int j = 0; j < docs.files[i].function_count; j++) {
-            function_t *func = &docs.files[i].functions[j];
-            if (strstr(func->name, term) || strstr(func->description, term) || 
-                strstr(func->signature, term)) {
-                docs.search_results[docs.search_count++] = i * 1000 + j;
-                if (docs.search_count >= MAX_ITEMS) return;
-            }
-        }
+    for (int written = 0; written < screen.out_size; ) {
+        ssize_t n = write(STDOUT_FILENO, screen.out + written, screen.out_size - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
     }
 }
 
-void find_undocumented_functions() {
-    docs.undocumented_count = 0;
+// Rows of the terminal the current frame has filled so far
+static int frame_rows(int cols) {
+    if (!screen.stream) return 0;
+    fflush(screen.stream);
+    int row, col;
+    layout_frame(screen.text, screen.text_size, NULL, 0, cols, &row, &col);
+    return row + (col > 0);
+}
+
+// The part of a `count` row list that fits below what the view has printed,
+// leaving `footer_rows` under it. The list scrolls only as far as needed to
+// keep the selection on screen, so a frame formats O(screen rows) entries
+// however long the list is.
+static void list_viewport(int count, int footer_rows, int *first, int *last) {
+    int rows, cols;
+    terminal_size(&rows, &cols);
+    int visible = rows - frame_rows(cols) - footer_rows - 1;  // - 1: the row the cursor ends on
+    if (visible < 1) visible = 1;
+    docs.list_rows = visible;
     
-    for (int i = 0; i < docs.file_count; i++) {
-        for (int j = 0; j < docs.files[i].function_count; j++) {
-            function_t *func = &docs.files[i].functions[j];
-            if (!func->is_documented) {
-                docs.undocumented_functions[docs.undocumented_count++] = func;
-                if (docs.undocumented_count >= MAX_ITEMS) return;
-            }
-        }
-    }
+    if (docs.current_selection < docs.list_top) docs.list_top = docs.current_selection;
+    if (docs.current_selection >= docs.list_top + visible) docs.list_top = docs.current_selection - visible + 1;
+    if (docs.list_top > count - visible) docs.list_top = count - visible;  // no blank rows after a shrink
+    if (docs.list_top < 0) docs.list_top = 0;
+    
+    *first = docs.list_top;
+    *last = docs.list_top + visible < count ? docs.list_top + visible : count;
 }
 
 // Display functions
@@ -428,20 +5020,15 @@ void display_header() {
 }
 
 void display_stats() {
-    int total_functions = 0, documented_functions = 0;
-    
-    for (int i = 0; i < docs.file_count; i++) {
-        for (int j = 0; j < docs.files[i].function_count; j++) {
-            total_functions++;
-            if (docs.files[i].functions[j].is_documented) {
-                documented_functions++;
-            }
-        }
-    }
-    
+    coverage_t coverage = project_coverage();
     printf(BLUE "📊 Project Stats: " RESET "%d files, %d functions, %d documented (%.1f%%)\n\n",
-           docs.file_count, total_functions, documented_functions,
-           total_functions > 0 ? (float)documented_functions / total_functions * 100 : 0);
+           docs.file_count, coverage.functions, coverage.documented, coverage_percent(coverage));
+}
+
+// The footer of a list that doesn't fit on screen
+static void display_list_position(int first, int last, int count, const char *what) {
+    if (last - first >= count) return;
+    printf(BLUE "\n%d-%d of %d %s, PgUp/PgDn or HOME/END to scroll\n" RESET, first + 1, last, count, what);
 }
 
 void display_files() {
@@ -450,79 +5037,101 @@ void display_files() {
     display_stats();
     
     printf(BOLD GREEN "SOURCE FILES\n" RESET);
-    printf("Use ↑/↓ to navigate, ENTER to view functions, 'p' to print file docs, 'P' to save printable docs, 'r' to rescan, 's' to search, 'u' for undocumented, 'q' to quit\n\n");
+    printf("Use ↑/↓ to navigate, ENTER to view functions, 'p' to print file docs, 'P' to save printable docs, 'r' to rescan, 's' to search, 'f' to find, 'g' to go to a function, 'u' for undocumented, 'q' to quit\n\n");
     
-    for (int i = 0; i < docs.file_count; i++) {
-        int documented = 0;
-        for (int j = 0; j < docs.files[i].function_count; j++) {
-            if (docs.files[i].functions[j].is_documented) documented++;
-        }
-        
+    if (scan.running) {
+        printf(BLUE "Scanning: %d files read, %d to go ('r' to stop)\n\n" RESET,
+               __atomic_load_n(&scan.parsed, __ATOMIC_RELAXED), __atomic_load_n(&scan.pending, __ATOMIC_RELAXED));
+    } else if (scan.cancelled) {
+        printf(YELLOW "Scan stopped, files may be missing ('r' to rescan)\n\n" RESET);
+    }
+    
+    int first, last;
+    list_viewport(docs.file_count, 2, &first, &last);
+    for (int i = first; i < last; i++) {
+        coverage_t coverage = file_coverage(docs.files[i]);
         if (i == docs.current_selection) {
             printf(BOLD YELLOW "► %s" RESET " (%d functions, %d documented)\n", 
-                   docs.files[i].filename, docs.files[i].function_count, documented);
+                   str(docs.files[i]->filename), coverage.functions, coverage.documented);
         } else {
             printf("  %s (%d functions, %d documented)\n", 
-                   docs.files[i].filename, docs.files[i].function_count, documented);
+                   str(docs.files[i]->filename), coverage.functions, coverage.documented);
         }
     }
     
-    if (docs.file_count == 0) {
+    if (docs.file_count == 0 && !scan.running) {
         printf(YELLOW "No C files found in current directory.\n" RESET);
     }
+    display_list_position(first, last, docs.file_count, "files");
 }
 
 void display_functions() {
     clear_screen();
     display_header();
     
-    source_file_t *file = &docs.files[docs.current_file];
-    printf(BOLD GREEN "\nFUNCTIONS in %s\n" RESET, file->filename);
+    source_file_t *file = docs.files[docs.current_file];
+    printf(BOLD GREEN "\nFUNCTIONS in %s\n" RESET, str(file->filename));
     printf("Use ↑/↓ to navigate, ENTER to view/edit docs, 'b' to go back\n\n");
     
-    for (int i = 0; i < file->function_count; i++) {
+    int first, last;
+    list_viewport(file->function_count, 2, &first, &last);
+    for (int i = first; i < last; i++) {
         function_t *func = &file->functions[i];
         char status_icon = func->is_documented ? '*' : ' ';
         char *status_color = func->is_documented ? GREEN : YELLOW;
         
         if (i == docs.current_selection) {
             printf(BOLD YELLOW "► " RESET "%s%c" RESET " %s " BLUE "(line %d)" RESET "\n", 
-                   status_color, status_icon, func->name, func->line_number);
+                   status_color, status_icon, str(func->name), func->line_number);
         } else {
             printf("  %s%c" RESET " %s " BLUE "(line %d)" RESET "\n", 
-                   status_color, status_icon, func->name, func->line_number);
+                   status_color, status_icon, str(func->name), func->line_number);
         }
     }
+    display_list_position(first, last, file->function_count, "functions");
 }
 
 void display_function_detail() {
     clear_screen();
     display_header();
     
-    function_t *func = &docs.files[docs.current_file].functions[docs.current_function];
+    function_t *func = &docs.files[docs.current_file]->functions[docs.current_function];
+    
+    const function_docs_t *doc = get_docs(func);
     
-    printf(BOLD GREEN "\nFUNCTION: %s\n" RESET, func->name);
-    printf("Press 'e' to edit documentation, 'v' to view source, 'b' to go back\n\n");
+    printf(BOLD GREEN "\nFUNCTION: %s\n" RESET, str(func->name));
+    printf("Press 'e' to edit documentation, 'v' to view source, 'c' for callers, 'C' for callees, "
+           "'b' to go back\n\n");
     
-    printf(BOLD CYAN "File: " RESET "%s:%d\n", func->filename, func->line_number);
-    printf(BOLD CYAN "Signature: " RESET "%s\n", func->signature);
-    printf(BOLD CYAN "Return Type: " RESET "%s\n\n", func->return_type);
+    printf(BOLD CYAN "File: " RESET "%s:%d\n", str(func->filename), func->line_number);
+    printf(BOLD CYAN "Signature: " RESET "%s\n", str(func->signature));
+    printf(BOLD CYAN "Return Type: " RESET "%s\n", str(func->return_type));
+    
+    // Calls into the project, by name
+    resolve_callee_names(docs.files[docs.current_file], docs.current_function);
+    for (int k = 0; k < callee_names.shown_count; k++) {
+        printf("%s%s", k ? ", " : BOLD CYAN "Calls: " RESET, str(callee_names.shown[k]));
+    }
+    if (callee_names.total > callee_names.shown_count) {
+        printf(" and %d more", callee_names.total - callee_names.shown_count);
+    }
+    printf("%s\n", callee_names.shown_count ? "\n" : "");
     
     if (func->is_documented) {
-        if (strlen(func->description) > 0) {
-            printf(BOLD CYAN "Description:\n" RESET "%s\n\n", func->description);
+        if (strlen(doc->description) > 0) {
+            printf(BOLD CYAN "Description:\n" RESET "%s\n\n", doc->description);
         }
-        if (strlen(func->parameters) > 0) {
-            printf(BOLD CYAN "Parameters:\n" RESET "%s\n\n", func->parameters);
+        if (strlen(doc->parameters) > 0) {
+            printf(BOLD CYAN "Parameters:\n" RESET "%s\n\n", doc->parameters);
         }
-        if (strlen(func->return_value) > 0) {
-            printf(BOLD CYAN "Return Value:\n" RESET "%s\n\n", func->return_value);
+        if (strlen(doc->return_value) > 0) {
+            printf(BOLD CYAN "Return Value:\n" RESET "%s\n\n", doc->return_value);
         }
-        if (strlen(func->example) > 0) {
-            printf(BOLD CYAN "Example:\n" RESET "%s\n\n", func->example);
+        if (strlen(doc->example) > 0) {
+            printf(BOLD CYAN "Example:\n" RESET "%s\n\n", doc->example);
         }
-        if (strlen(func->notes) > 0) {
-            printf(BOLD CYAN "Notes:\n" RESET "%s\n\n", func->notes);
+        if (strlen(doc->notes) > 0) {
+            printf(BOLD CYAN "Notes:\n" RESET "%s\n\n", doc->notes);
         }
     } else {
         printf(YELLOW "This function is not yet documented. Press 'e' to add documentation.\n" RESET);
@@ -533,14 +5142,14 @@ void display_auto_parsed_info() {
     clear_screen();
     display_header();
     
-    function_t *func = &docs.files[docs.current_file].functions[docs.current_function];
+    function_t *func = &docs.files[docs.current_file]->functions[docs.current_function];
     
-    printf(BOLD GREEN "\nFUNCTION INFO: %s\n" RESET, func->name);
+    printf(BOLD GREEN "\nFUNCTION INFO: %s\n" RESET, str(func->name));
     printf("Press any key to go back\n\n");
     
-    printf(BOLD CYAN "Return Type: " RESET "%s\n", func->return_type);
-    printf(BOLD CYAN "Signature: " RESET "%s\n", func->signature);
-    printf(BOLD CYAN "File: " RESET "%s:%d\n", func->filename, func->line_number);
+    printf(BOLD CYAN "Return Type: " RESET "%s\n", str(func->return_type));
+    printf(BOLD CYAN "Signature: " RESET "%s\n", str(func->signature));
+    printf(BOLD CYAN "File: " RESET "%s:%d\n", str(func->filename), func->line_number);
     
     getchar();
 }
@@ -549,28 +5158,56 @@ void display_search_results() {
     clear_screen();
     display_header();
     
-    printf(BOLD GREEN "\nSEARCH RESULTS for \"%s\"\n" RESET, docs.search_term);
-    printf("Use ↑/↓ to navigate, ENTER to view, 'b' to go back\n\n");
+    if (docs.search_editing) {
+        printf(BOLD GREEN "\nSEARCH: " RESET "%s" BOLD "_" RESET "\n", docs.search_term);
+        if (docs.search_stale) {
+            printf("Press ENTER to run the pattern\n\n");
+        } else {
+            printf("Type to refine (start with %c for a regex), ↑/↓ to navigate, ENTER to view, "
+                   "TAB to stop typing, BACKSPACE past the start to go back\n\n", SEARCH_REGEX_PREFIX);
+        }
+    } else {
+        static const char *const titles[] = {
+            [SEARCH_QUERY] = "SEARCH RESULTS for", [SEARCH_FUZZY] = "BEST MATCHES for",
+            [SEARCH_CALLERS] = "CALLERS of", [SEARCH_CALLEES] = "CALLEES of",
+            [SEARCH_DEFINITIONS] = "DEFINITIONS of"
+        };
+        printf(BOLD GREEN "\n%s \"%s\"\n" RESET, titles[docs.search_source], docs.search_term);
+        printf("Use ↑/↓ to navigate, ENTER to view, %s'b' to go back\n\n",
+               docs.search_source == SEARCH_QUERY ? "'s' to refine, " : "");
+    }
     
-    for (int i = 0; i < docs.search_count; i++) {
-        int file_idx = docs.search_results[i] / 1000;
-        int func_idx = docs.search_results[i] % 1000;
-        function_t *func = &docs.files[file_idx].functions[func_idx];
+    int first, last;
+    list_viewport(docs.search_count, 2, &first, &last);
+    for (int i = first; i < last; i++) {
+        func_ref_t ref = docs.search_results[i];
+        function_t *func = &docs.files[ref.file]->functions[ref.func];
         
         char status_icon = func->is_documented ? '*' : ' ';
         char *status_color = func->is_documented ? GREEN : YELLOW;
         
         if (i == docs.current_selection) {
             printf(BOLD YELLOW "► " RESET "%s%c %s::%s" RESET " " BLUE "(line %d)" RESET "\n",
-                   status_color, status_icon, func->filename, func->name, func->line_number);
+                   status_color, status_icon, str(func->filename), str(func->name), func->line_number);
         } else {
             printf("  %s%c %s::%s" RESET " " BLUE "(line %d)" RESET "\n",
-                   status_color, status_icon, func->filename, func->name, func->line_number);
+                   status_color, status_icon, str(func->filename), str(func->name), func->line_number);
         }
     }
     
-    if (docs.search_count == 0) {
-        printf(YELLOW "No results found.\n" RESET);
+    if (docs.search_error[0]) {
+        printf(RED "Invalid %s: %s\n" RESET,
+               docs.search_term[0] == SEARCH_REGEX_PREFIX ? "pattern" : "query", docs.search_error);
+    } else if (docs.search_count == 0) {
+        if ((!docs.search_editing || docs.search_term[0]) && !docs.search_stale) {
+            printf(YELLOW "No results found.\n" RESET);
+        }
+    } else if (!docs.search_complete) {
+        printf(BLUE "\n%d-%d of the first %d matches (TAB finds them all)\n" RESET, first + 1, last,
+               docs.search_count);
+    } else {
+        display_list_position(first, last, docs.search_count,
+                              docs.search_source == SEARCH_FUZZY ? "best matches" : "matches");
     }
 }
 
@@ -581,45 +5218,50 @@ void display_undocumented() {
     printf(BOLD GREEN "\nUNDOCUMENTED FUNCTIONS\n" RESET);
     printf("Use ↑/↓ to navigate, ENTER to document, 'b' to go back\n\n");
     
-    for (int i = 0; i < docs.undocumented_count; i++) {
+    int first, last;
+    list_viewport(docs.undocumented_count, 2, &first, &last);
+    for (int i = first; i < last; i++) {
         function_t *func = docs.undocumented_functions[i];
         
         if (i == docs.current_selection) {
             printf(BOLD YELLOW "► %s::%s" RESET " " BLUE "(line %d)" RESET "\n",
-                   func->filename, func->name, func->line_number);
+                   str(func->filename), str(func->name), func->line_number);
         } else {
             printf("  %s::%s " BLUE "(line %d)" RESET "\n",
-                   func->filename, func->name, func->line_number);
+                   str(func->filename), str(func->name), func->line_number);
         }
     }
     
     if (docs.undocumented_count == 0) {
         printf(GREEN "All functions are documented!\n" RESET);
     }
+    display_list_position(first, last, docs.undocumented_count, "functions");
 }
 
 // Function source code extraction
 void print_function_source(function_t *func) {
-    FILE *f = fopen(func->filename, "r");
+    FILE *f = fopen(str(func->filename), "r");
     if (!f) {
-        printf(RED "Could not open %s to display function source.\n" RESET, func->filename);
+        printf(RED "Could not open %s to display function source.\n" RESET, str(func->filename));
         return;
     }
     
-    char line[MAX_LINE_LENGTH];
+    // Whole lines, so the count matches the parser's however long they are
+    char *line = NULL;
+    size_t line_capacity = 0;
     int current_line = 0;
     int brace_count = 0;
     int found_function = 0;
     int in_function = 0;
     
     // Check if this is a header file
-    int len = strlen(func->filename);
-    int is_header = (len > 2 && strcmp(func->filename + len - 2, ".h") == 0);
+    int len = strlen(str(func->filename));
+    int is_header = (len > 2 && strcmp(str(func->filename) + len - 2, ".h") == 0);
     
     printf(BOLD CYAN "\nFunction Source Code:\n" RESET);
     printf(CYAN "----------------------------------------\n" RESET);
     
-    while (fgets(line, sizeof(line), f)) {
+    while (getline(&line, &line_capacity, f) != -1) {
         current_line++;
         
         if (current_line == func->line_number) {
@@ -666,6 +5308,7 @@ void print_function_source(function_t *func) {
         printf(RED "Could not find function at line %d\n" RESET, func->line_number);
     }
     
+    free(line);
     fclose(f);
 }
 
@@ -678,7 +5321,7 @@ void save_printable_documentation(source_file_t *file) {
     clear_screen();
     display_header();
     
-    printf(BOLD GREEN "SAVE PRINTABLE DOCUMENTATION FOR: %s\n" RESET, file->filename);
+    printf(BOLD GREEN "SAVE PRINTABLE DOCUMENTATION FOR: %s\n" RESET, str(file->filename));
     printf("Choose output format:\n\n");
     
     printf(BOLD CYAN "Output Format Options:\n" RESET);
@@ -693,14 +5336,15 @@ void save_printable_documentation(source_file_t *file) {
     getchar(); // consume newline
     
     char base_name[MAX_PATH_LENGTH];
-    char *dot = strrchr(file->filename, '.');
+    const char *source_name = str(file->filename);
+    const char *dot = strrchr(source_name, '.');
     if (dot) {
-        int len = dot - file->filename;
+        int len = dot - source_name;
         if (len >= MAX_PATH_LENGTH) len = MAX_PATH_LENGTH - 1;
-        strncpy(base_name, file->filename, len);
+        strncpy(base_name, source_name, len);
         base_name[len] = '\0';
     } else {
-        strncpy(base_name, file->filename, MAX_PATH_LENGTH - 1);
+        strncpy(base_name, source_name, MAX_PATH_LENGTH - 1);
         base_name[MAX_PATH_LENGTH - 1] = '\0';
     }
     
@@ -745,7 +5389,7 @@ void save_as_text(source_file_t *file, const char *filename, struct tm *tm_info)
     fprintf(f, "                         C PROJECT DOCUMENTATION                               \n");
     fprintf(f, "════════════════════════════════════════════════════════════════════════════════\n\n");
     
-    fprintf(f, "File: %s\n", file->filename);
+    fprintf(f, "File: %s\n", str(file->filename));
     fprintf(f, "Generated: %s", asctime(tm_info));
     fprintf(f, "Generated by: DOK - Dynamic C Documentation System\n\n");
     
@@ -769,7 +5413,7 @@ void save_as_markdown(source_file_t *file, const char *filename, struct tm *tm_i
     
     // Write header
     fprintf(f, "# C Project Documentation\n\n");
-    fprintf(f, "**File:** `%s`  \n", file->filename);
+    fprintf(f, "**File:** `%s`  \n", str(file->filename));
     fprintf(f, "**Generated:** %s", asctime(tm_info));
     fprintf(f, "**Generated by:** DOK - Dynamic C Documentation System\n\n");
     
@@ -793,7 +5437,7 @@ void save_as_html(source_file_t *file, const char *filename, struct tm *tm_info)
     
     // Write HTML header
     fprintf(f, "<!DOCTYPE html>\n<html>\n<head>\n");
-    fprintf(f, "<title>Documentation - %s</title>\n", file->filename);
+    fprintf(f, "<title>Documentation - %s</title>\n", str(file->filename));
     fprintf(f, "<style>\n");
     fprintf(f, "body { font-family: 'Courier New', monospace; margin: 40px; line-height: 1.4; }\n");
     fprintf(f, "h1 { color: #2c3e50; border-bottom: 2px solid #3498db; }\n");
@@ -806,7 +5450,7 @@ void save_as_html(source_file_t *file, const char *filename, struct tm *tm_info)
     fprintf(f, "</style>\n</head>\n<body>\n");
     
     fprintf(f, "<h1>C Project Documentation</h1>\n");
-    fprintf(f, "<p><strong>File:</strong> <code>%s</code></p>\n", file->filename);
+    fprintf(f, "<p><strong>File:</strong> <code>%s</code></p>\n", str(file->filename));
     fprintf(f, "<p><strong>Generated:</strong> %s</p>\n", asctime(tm_info));
     fprintf(f, "<p><strong>Generated by:</strong> DOK - Dynamic C Documentation System</p>\n");
     
@@ -831,7 +5475,7 @@ void save_as_postscript(source_file_t *file, const char *filename, struct tm *tm
     
     // Write PostScript header
     fprintf(f, "%%!PS-Adobe-3.0\n");
-    fprintf(f, "%%%%Title: Documentation - %s\n", file->filename);
+    fprintf(f, "%%%%Title: Documentation - %s\n", str(file->filename));
     fprintf(f, "%%%%Creator: DOK - Dynamic C Documentation System\n");
     fprintf(f, "%%%%Pages: (atend)\n");
     fprintf(f, "%%%%EndComments\n\n");
@@ -846,7 +5490,7 @@ void save_as_postscript(source_file_t *file, const char *filename, struct tm *tm
     fprintf(f, "title\n");
     fprintf(f, "(C PROJECT DOCUMENTATION) show newline newline\n");
     fprintf(f, "normal\n");
-    fprintf(f, "(File: %s) show newline\n", file->filename);
+    fprintf(f, "(File: %s) show newline\n", str(file->filename));
     fprintf(f, "(Generated: %s) show newline\n", asctime(tm_info));
     fprintf(f, "(Generated by: DOK) show newline newline\n");
     
@@ -866,17 +5510,13 @@ void save_as_postscript(source_file_t *file, const char *filename, struct tm *tm
 
 // Helper functions for writing function documentation in different formats
 void write_function_docs_text(FILE *f, source_file_t *file) {
-    int total_functions = file->function_count;
-    int documented_functions = 0;
-    for (int i = 0; i < file->function_count; i++) {
-        if (file->functions[i].is_documented) documented_functions++;
-    }
+    coverage_t coverage = file_coverage(file);
     
     fprintf(f, "Project Statistics:\n");
-    fprintf(f, "  Total functions: %d\n", total_functions);
-    fprintf(f, "  Documented functions: %d\n", documented_functions);
+    fprintf(f, "  Total functions: %d\n", coverage.functions);
+    fprintf(f, "  Documented functions: %d\n", coverage.documented);
     fprintf(f, "  Documentation coverage: %.1f%%\n\n", 
-            total_functions > 0 ? (float)documented_functions / total_functions * 100 : 0);
+            coverage_percent(coverage));
     
     if (file->function_count == 0) {
         fprintf(f, "No functions found in this file.\n");
@@ -889,27 +5529,28 @@ void write_function_docs_text(FILE *f, source_file_t *file) {
     
     for (int i = 0; i < file->function_count; i++) {
         function_t *func = &file->functions[i];
+        const function_docs_t *doc = get_docs(func);
         
-        fprintf(f, "Function: %s (Line %d)\n", func->name, func->line_number);
+        fprintf(f, "Function: %s (Line %d)\n", str(func->name), func->line_number);
         fprintf(f, "────────────────────────────────────────────────────────────────────────────────\n");
-        fprintf(f, "Signature: %s\n", func->signature);
-        fprintf(f, "Return Type: %s\n\n", func->return_type);
+        fprintf(f, "Signature: %s\n", str(func->signature));
+        fprintf(f, "Return Type: %s\n\n", str(func->return_type));
         
         if (func->is_documented) {
-            if (strlen(func->description) > 0) {
-                fprintf(f, "Description:\n%s\n\n", func->description);
+            if (strlen(doc->description) > 0) {
+                fprintf(f, "Description:\n%s\n\n", doc->description);
             }
-            if (strlen(func->parameters) > 0) {
-                fprintf(f, "Parameters:\n%s\n\n", func->parameters);
+            if (strlen(doc->parameters) > 0) {
+                fprintf(f, "Parameters:\n%s\n\n", doc->parameters);
             }
-            if (strlen(func->return_value) > 0) {
-                fprintf(f, "Return Value:\n%s\n\n", func->return_value);
+            if (strlen(doc->return_value) > 0) {
+                fprintf(f, "Return Value:\n%s\n\n", doc->return_value);
             }
-            if (strlen(func->example) > 0) {
-                fprintf(f, "Example:\n%s\n\n", func->example);
+            if (strlen(doc->example) > 0) {
+                fprintf(f, "Example:\n%s\n\n", doc->example);
             }
-            if (strlen(func->notes) > 0) {
-                fprintf(f, "Notes:\n%s\n\n", func->notes);
+            if (strlen(doc->notes) > 0) {
+                fprintf(f, "Notes:\n%s\n\n", doc->notes);
             }
         } else {
             fprintf(f, "*** NOT YET DOCUMENTED ***\n\n");
@@ -920,17 +5561,13 @@ void write_function_docs_text(FILE *f, source_file_t *file) {
 }
 
 void write_function_docs_markdown(FILE *f, source_file_t *file) {
-    int total_functions = file->function_count;
-    int documented_functions = 0;
-    for (int i = 0; i < file->function_count; i++) {
-        if (file->functions[i].is_documented) documented_functions++;
-    }
+    coverage_t coverage = file_coverage(file);
     
     fprintf(f, "## Project Statistics\n\n");
-    fprintf(f, "- **Total functions:** %d\n", total_functions);
-    fprintf(f, "- **Documented functions:** %d\n", documented_functions);
+    fprintf(f, "- **Total functions:** %d\n", coverage.functions);
+    fprintf(f, "- **Documented functions:** %d\n", coverage.documented);
     fprintf(f, "- **Documentation coverage:** %.1f%%\n\n", 
-            total_functions > 0 ? (float)documented_functions / total_functions * 100 : 0);
+            coverage_percent(coverage));
     
     if (file->function_count == 0) {
         fprintf(f, "No functions found in this file.\n");
@@ -941,26 +5578,27 @@ void write_function_docs_markdown(FILE *f, source_file_t *file) {
     
     for (int i = 0; i < file->function_count; i++) {
         function_t *func = &file->functions[i];
+        const function_docs_t *doc = get_docs(func);
         
-        fprintf(f, "### %s (Line %d)\n\n", func->name, func->line_number);
-        fprintf(f, "**Signature:** `%s`  \n", func->signature);
-        fprintf(f, "**Return Type:** `%s`\n\n", func->return_type);
+        fprintf(f, "### %s (Line %d)\n\n", str(func->name), func->line_number);
+        fprintf(f, "**Signature:** `%s`  \n", str(func->signature));
+        fprintf(f, "**Return Type:** `%s`\n\n", str(func->return_type));
         
         if (func->is_documented) {
-            if (strlen(func->description) > 0) {
-                fprintf(f, "**Description:**  \n%s\n\n", func->description);
+            if (strlen(doc->description) > 0) {
+                fprintf(f, "**Description:**  \n%s\n\n", doc->description);
             }
-            if (strlen(func->parameters) > 0) {
-                fprintf(f, "**Parameters:**  \n%s\n\n", func->parameters);
+            if (strlen(doc->parameters) > 0) {
+                fprintf(f, "**Parameters:**  \n%s\n\n", doc->parameters);
             }
-            if (strlen(func->return_value) > 0) {
-                fprintf(f, "**Return Value:**  \n%s\n\n", func->return_value);
+            if (strlen(doc->return_value) > 0) {
+                fprintf(f, "**Return Value:**  \n%s\n\n", doc->return_value);
             }
-            if (strlen(func->example) > 0) {
-                fprintf(f, "**Example:**  \n```c\n%s\n```\n\n", func->example);
+            if (strlen(doc->example) > 0) {
+                fprintf(f, "**Example:**  \n```c\n%s\n```\n\n", doc->example);
             }
-            if (strlen(func->notes) > 0) {
-                fprintf(f, "**Notes:**  \n%s\n\n", func->notes);
+            if (strlen(doc->notes) > 0) {
+                fprintf(f, "**Notes:**  \n%s\n\n", doc->notes);
             }
         } else {
             fprintf(f, "*Not yet documented*\n\n");
@@ -971,18 +5609,14 @@ void write_function_docs_markdown(FILE *f, source_file_t *file) {
 }
 
 void write_function_docs_html(FILE *f, source_file_t *file) {
-    int total_functions = file->function_count;
-    int documented_functions = 0;
-    for (int i = 0; i < file->function_count; i++) {
-        if (file->functions[i].is_documented) documented_functions++;
-    }
+    coverage_t coverage = file_coverage(file);
     
     fprintf(f, "<h2>Project Statistics</h2>\n");
     fprintf(f, "<ul>\n");
-    fprintf(f, "<li><strong>Total functions:</strong> %d</li>\n", total_functions);
-    fprintf(f, "<li><strong>Documented functions:</strong> %d</li>\n", documented_functions);
+    fprintf(f, "<li><strong>Total functions:</strong> %d</li>\n", coverage.functions);
+    fprintf(f, "<li><strong>Documented functions:</strong> %d</li>\n", coverage.documented);
     fprintf(f, "<li><strong>Documentation coverage:</strong> %.1f%%</li>\n", 
-            total_functions > 0 ? (float)documented_functions / total_functions * 100 : 0);
+            coverage_percent(coverage));
     fprintf(f, "</ul>\n\n");
     
     if (file->function_count == 0) {
@@ -994,27 +5628,28 @@ void write_function_docs_html(FILE *f, source_file_t *file) {
     
     for (int i = 0; i < file->function_count; i++) {
         function_t *func = &file->functions[i];
+        const function_docs_t *doc = get_docs(func);
         
         fprintf(f, "<div class=\"function\">\n");
-        fprintf(f, "<h3>%s <small>(Line %d)</small></h3>\n", func->name, func->line_number);
-        fprintf(f, "<div class=\"signature\">%s</div>\n", func->signature);
-        fprintf(f, "<p><strong>Return Type:</strong> <code>%s</code></p>\n", func->return_type);
+        fprintf(f, "<h3>%s <small>(Line %d)</small></h3>\n", str(func->name), func->line_number);
+        fprintf(f, "<div class=\"signature\">%s</div>\n", str(func->signature));
+        fprintf(f, "<p><strong>Return Type:</strong> <code>%s</code></p>\n", str(func->return_type));
         
         if (func->is_documented) {
-            if (strlen(func->description) > 0) {
-                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Description:</span><br>%s</div>\n", func->description);
+            if (strlen(doc->description) > 0) {
+                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Description:</span><br>%s</div>\n", doc->description);
             }
-            if (strlen(func->parameters) > 0) {
-                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Parameters:</span><br><pre>%s</pre></div>\n", func->parameters);
+            if (strlen(doc->parameters) > 0) {
+                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Parameters:</span><br><pre>%s</pre></div>\n", doc->parameters);
             }
-            if (strlen(func->return_value) > 0) {
-                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Return Value:</span><br>%s</div>\n", func->return_value);
+            if (strlen(doc->return_value) > 0) {
+                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Return Value:</span><br>%s</div>\n", doc->return_value);
             }
-            if (strlen(func->example) > 0) {
-                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Example:</span><br><pre>%s</pre></div>\n", func->example);
+            if (strlen(doc->example) > 0) {
+                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Example:</span><br><pre>%s</pre></div>\n", doc->example);
             }
-            if (strlen(func->notes) > 0) {
-                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Notes:</span><br>%s</div>\n", func->notes);
+            if (strlen(doc->notes) > 0) {
+                fprintf(f, "<div class=\"field\"><span class=\"field-name\">Notes:</span><br>%s</div>\n", doc->notes);
             }
         } else {
             fprintf(f, "<p><em>Not yet documented</em></p>\n");
@@ -1029,16 +5664,17 @@ void write_function_docs_postscript(FILE *f, source_file_t *file) {
     
     for (int i = 0; i < file->function_count; i++) {
         function_t *func = &file->functions[i];
+        const function_docs_t *doc = get_docs(func);
         
         fprintf(f, "72 %d moveto\n", y_pos);
         fprintf(f, "title\n");
-        fprintf(f, "(%s) show newline\n", func->name);
+        fprintf(f, "(%s) show newline\n", str(func->name));
         fprintf(f, "normal\n");
-        fprintf(f, "(Signature: %s) show newline\n", func->signature);
-        fprintf(f, "(Return Type: %s) show newline\n", func->return_type);
+        fprintf(f, "(Signature: %s) show newline\n", str(func->signature));
+        fprintf(f, "(Return Type: %s) show newline\n", str(func->return_type));
         
-        if (func->is_documented && strlen(func->description) > 0) {
-            fprintf(f, "(Description: %s) show newline\n", func->description);
+        if (func->is_documented && strlen(doc->description) > 0) {
+            fprintf(f, "(Description: %s) show newline\n", doc->description);
         } else {
             fprintf(f, "(Not yet documented) show newline\n");
         }
@@ -1053,7 +5689,7 @@ void print_file_documentation(source_file_t *file) {
     clear_screen();
     display_header();
     
-    printf(BOLD GREEN "COMPLETE DOCUMENTATION FOR: %s\n" RESET, file->filename);
+    printf(BOLD GREEN "COMPLETE DOCUMENTATION FOR: %s\n" RESET, str(file->filename));
     printf("Generated by DOK - Dynamic C Documentation System\n\n");
     
     if (file->function_count == 0) {
@@ -1065,9 +5701,10 @@ void print_file_documentation(source_file_t *file) {
     
     for (int i = 0; i < file->function_count; i++) {
         function_t *func = &file->functions[i];
+        const function_docs_t *doc = get_docs(func);
         
         printf("════════════════════════════════════════════════════════════════════════\n");
-        printf(BOLD CYAN "FUNCTION: %s" RESET " (Line %d)\n", func->name, func->line_number);
+        printf(BOLD CYAN "FUNCTION: %s" RESET " (Line %d)\n", str(func->name), func->line_number);
         printf("════════════════════════════════════════════════════════════════════════\n");
         
         // Show source code
@@ -1077,20 +5714,20 @@ void print_file_documentation(source_file_t *file) {
         printf(BOLD CYAN "DOCUMENTATION:\n" RESET);
         
         if (func->is_documented) {
-            if (strlen(func->description) > 0) {
-                printf(BOLD "Description:" RESET " %s\n", func->description);
+            if (strlen(doc->description) > 0) {
+                printf(BOLD "Description:" RESET " %s\n", doc->description);
             }
-            if (strlen(func->parameters) > 0) {
-                printf(BOLD "Parameters:" RESET " %s\n", func->parameters);
+            if (strlen(doc->parameters) > 0) {
+                printf(BOLD "Parameters:" RESET " %s\n", doc->parameters);
             }
-            if (strlen(func->return_value) > 0) {
-                printf(BOLD "Return Value:" RESET " %s\n", func->return_value);
+            if (strlen(doc->return_value) > 0) {
+                printf(BOLD "Return Value:" RESET " %s\n", doc->return_value);
             }
-            if (strlen(func->example) > 0) {
-                printf(BOLD "Example:" RESET " %s\n", func->example);
+            if (strlen(doc->example) > 0) {
+                printf(BOLD "Example:" RESET " %s\n", doc->example);
             }
-            if (strlen(func->notes) > 0) {
-                printf(BOLD "Notes:" RESET " %s\n", func->notes);
+            if (strlen(doc->notes) > 0) {
+                printf(BOLD "Notes:" RESET " %s\n", doc->notes);
             }
         } else {
             printf(YELLOW "*** NOT YET DOCUMENTED ***\n" RESET);
@@ -1107,7 +5744,7 @@ void print_file_documentation(source_file_t *file) {
     }
     
     printf("════════════════════════════════════════════════════════════════════════\n");
-    printf(BOLD GREEN "END OF DOCUMENTATION FOR %s\n" RESET, file->filename);
+    printf(BOLD GREEN "END OF DOCUMENTATION FOR %s\n" RESET, str(file->filename));
     printf("════════════════════════════════════════════════════════════════════════\n");
     printf("\nPress any key to continue...");
     getchar();
@@ -1115,6 +5752,7 @@ void print_file_documentation(source_file_t *file) {
 
 // Input handling
 void get_string_input(const char *prompt, char *buffer, int max_length) {
+    screen.front_valid = 0;
     disable_raw_mode();
     printf("%s", prompt);
     fflush(stdout);
@@ -1129,8 +5767,8 @@ void get_string_input(const char *prompt, char *buffer, int max_length) {
 
 void edit_function_documentation(function_t *func) {
     clear_screen();
-    printf(BOLD CYAN "Editing documentation for: %s\n" RESET, func->name);
-    printf("File: %s:%d\n", func->filename, func->line_number);
+    printf(BOLD CYAN "Editing documentation for: %s\n" RESET, str(func->name));
+    printf("File: %s:%d\n", str(func->filename), func->line_number);
     
     // Show the function source code
     print_function_source(func);
@@ -1140,55 +5778,206 @@ void edit_function_documentation(function_t *func) {
     printf("Press ENTER after each field to continue...\n\n");
     
     char temp_buffer[MAX_CONTENT_LENGTH];
+    load_function_documentation(func);
+    function_docs_t *doc = edit_docs(func);
+    if (!doc) return;
+    char *old_description = strdup(doc->description);
     
     // Description
-    printf(BOLD "Current description:" RESET " %s\n", func->description);
+    printf(BOLD "Current description:" RESET " %s\n", doc->description);
     get_string_input("New description: ", temp_buffer, MAX_CONTENT_LENGTH);
     if (strlen(temp_buffer) > 0) {
-        strncpy(func->description, temp_buffer, MAX_CONTENT_LENGTH - 1);
-        func->description[MAX_CONTENT_LENGTH - 1] = '\0';
+        set_doc_text(&doc->description, temp_buffer);
     }
     
     // Parameters
-    printf(BOLD "\nCurrent parameters:" RESET " %s\n", func->parameters);
+    printf(BOLD "\nCurrent parameters:" RESET " %s\n", doc->parameters);
     get_string_input("New parameters: ", temp_buffer, MAX_CONTENT_LENGTH);
     if (strlen(temp_buffer) > 0) {
-        strncpy(func->parameters, temp_buffer, MAX_CONTENT_LENGTH - 1);
-        func->parameters[MAX_CONTENT_LENGTH - 1] = '\0';
+        set_doc_text(&doc->parameters, temp_buffer);
     }
     
     // Return value
-    printf(BOLD "\nCurrent return value:" RESET " %s\n", func->return_value);
+    printf(BOLD "\nCurrent return value:" RESET " %s\n", doc->return_value);
     get_string_input("New return value: ", temp_buffer, MAX_CONTENT_LENGTH);
     if (strlen(temp_buffer) > 0) {
-        strncpy(func->return_value, temp_buffer, MAX_CONTENT_LENGTH - 1);
-        func->return_value[MAX_CONTENT_LENGTH - 1] = '\0';
+        set_doc_text(&doc->return_value, temp_buffer);
     }
     
     // Example
-    printf(BOLD "\nCurrent example:" RESET " %s\n", func->example);
+    printf(BOLD "\nCurrent example:" RESET " %s\n", doc->example);
     get_string_input("New example: ", temp_buffer, MAX_CONTENT_LENGTH);
     if (strlen(temp_buffer) > 0) {
-        strncpy(func->example, temp_buffer, MAX_CONTENT_LENGTH - 1);
-        func->example[MAX_CONTENT_LENGTH - 1] = '\0';
+        set_doc_text(&doc->example, temp_buffer);
     }
     
     // Notes
-    printf(BOLD "\nCurrent notes:" RESET " %s\n", func->notes);
+    printf(BOLD "\nCurrent notes:" RESET " %s\n", doc->notes);
     get_string_input("New notes: ", temp_buffer, MAX_CONTENT_LENGTH);
     if (strlen(temp_buffer) > 0) {
-        strncpy(func->notes, temp_buffer, MAX_CONTENT_LENGTH - 1);
-        func->notes[MAX_CONTENT_LENGTH - 1] = '\0';
+        set_doc_text(&doc->notes, temp_buffer);
     }
     
-    func->is_documented = 1;
-    save_documentation();
+    set_documented(func);
+    int saved = record_documentation(func);
+    if (old_description) reindex_function(func, old_description);
+    free(old_description);
     
-    printf(GREEN "\nDocumentation saved!\n" RESET);
+    if (saved) {
+        printf(GREEN "\nDocumentation saved!\n" RESET);
+    } else {
+        printf(YELLOW "\nDocumentation will be saved once the scan has finished.\n" RESET);
+    }
     printf("Press any key to continue...");
     getchar();
 }
 
+// Go-to-symbol prompt: type a function name, TAB completes it as far as
+// it is unambiguous, ENTER jumps to it. A name defined in several files
+// lists the definitions as search results instead. Backspace on an empty
+// name cancels.
+#define GOTO_CANDIDATES 10
+
+static void display_goto_prompt(const char *name, uint32_t first, uint32_t last) {
+    clear_screen();
+    display_header();
+    printf(BOLD GREEN "\nGO TO SYMBOL: " RESET "%s" BOLD "_" RESET "\n", name);
+    printf("TAB to complete, ENTER to jump, BACKSPACE past the start to cancel\n\n");
+    
+    if (!name[0]) return;
+    if (first == last) {
+        printf(YELLOW "No function starts with \"%s\".\n" RESET, name);
+        return;
+    }
+    
+    // Distinct names, each once; duplicates sort next to each other
+    int shown = 0;
+    for (uint32_t i = first; i < last && shown < GOTO_CANDIDATES; shown++) {
+        const char *candidate = ordinal_name(name_order.ordinals[i]);
+        uint32_t end = i + 1;
+        while (end < last && strcmp(ordinal_name(name_order.ordinals[end]), candidate) == 0) end++;
+        
+        func_ref_t ref = search_index.refs[name_order.ordinals[i]];
+        if (end - i > 1) {
+            printf("  %s " BLUE "(%u definitions)" RESET "\n", candidate, end - i);
+        } else {
+            printf("  %s " BLUE "(%s)" RESET "\n", candidate, str(docs.files[ref.file]->filename));
+        }
+        i = end;
+    }
+    printf(BLUE "\n%u function%s\n" RESET, last - first, last - first == 1 ? "" : "s");
+}
+
+// Jump to the function(s) named exactly `name`. Returns 0 if there are none.
+static int goto_symbol_named(const char *name) {
+    uint32_t first, last;
+    if (!find_names(name, 1, &first, &last) || first == last) return 0;
+    
+    if (last - first == 1) {
+        func_ref_t ref = search_index.refs[name_order.ordinals[first]];
+        docs.current_file = ref.file;
+        docs.current_function = ref.func;
+        docs.state = STATE_FUNCTION_DETAIL;
+        return 1;
+    }
+    
+    find_definitions(name);
+    if (docs.search_count == 0) return 0;
+    snprintf(docs.search_term, sizeof(docs.search_term), "%s", name);
+    docs.search_complete = 1;
+    docs.search_source = SEARCH_DEFINITIONS;
+    docs.search_editing = 0;
+    docs.search_stale = 0;
+    docs.search_error[0] = '\0';
+    docs.current_selection = 0;
+    docs.state = STATE_SEARCH;
+    return 1;
+}
+
+void goto_symbol() {
+    char name[MAX_NAME_LENGTH] = "";
+    uint32_t first = 0, last = 0;
+    
+    while (1) {
+        if (!find_names(name, 0, &first, &last)) return;
+        begin_frame();
+        display_goto_prompt(name, first, last);
+        end_frame();
+        
+        size_t len = strlen(name);
+        int c = getchar();
+        if (c == EOF) return;
+        
+        if (c == '\033') {
+            read_escape_key();
+        } else if (c == 127 || c == '\b') {
+            if (len == 0) return;
+            name[len - 1] = '\0';
+        } else if (c == '\t' && len > 0 && first < last) {
+            // Every name in the range shares what its first and last share
+            const char *a = ordinal_name(name_order.ordinals[first]);
+            const char *b = ordinal_name(name_order.ordinals[last - 1]);
+            size_t common = 0;
+            while (a[common] && a[common] == b[common] && common < sizeof(name) - 1) common++;
+            memcpy(name, a, common);
+            name[common] = '\0';
+        } else if (c == '\n' || c == '\r') {
+            if (goto_symbol_named(name)) return;
+            // A prefix naming one function is as good as its full name
+            if (first < last) {
+                const char *only = ordinal_name(name_order.ordinals[first]);
+                if (strcmp(only, ordinal_name(name_order.ordinals[last - 1])) == 0 &&
+                    goto_symbol_named(only)) return;
+            }
+        } else if (isalnum(c) || c == '_') {
+            if (len < sizeof(name) - 1) {
+                name[len] = c;
+                name[len + 1] = '\0';
+            }
+        }
+    }
+}
+
+// Live search keys: printable characters and backspace edit the query and
+// re-run it, TAB stops typing so keys act as commands again. Regex queries
+// only run on ENTER, as half-typed patterns rarely compile. Returns 0 for
+// keys that keep their usual meaning (arrows, ENTER on a query that has run).
+static int edit_search_query(char c) {
+    size_t len = strlen(docs.search_term);
+    
+    if ((c == '\n' || c == '\r') && docs.search_stale) {
+        docs.search_stale = 0;
+        live_search(docs.search_term);
+        docs.current_selection = 0;
+        return 1;
+    } else if (c == 127 || c == '\b') {
+        if (len == 0) {
+            docs.search_editing = 0;
+            docs.state = STATE_FILES;
+            docs.current_selection = 0;
+            return 1;
+        }
+        docs.search_term[len - 1] = '\0';
+    } else if (c == '\t') {
+        docs.search_editing = 0;
+        finish_search();
+        return 1;
+    } else if (isprint((unsigned char)c)) {
+        if (len >= MAX_NAME_LENGTH - 1) return 1;
+        docs.search_term[len] = c;
+        docs.search_term[len + 1] = '\0';
+    } else {
+        return 0;
+    }
+    
+    docs.search_stale = docs.search_term[0] == SEARCH_REGEX_PREFIX;
+    if (!docs.search_stale) {
+        live_search(docs.search_term);
+        docs.current_selection = 0;
+    }
+    return 1;
+}
+
 void handle_input() {
     char c = getchar();
     
@@ -1199,43 +5988,51 @@ void handle_input() {
                     exit(0);
                     break;
                 case 'r':
-                    printf("Rescanning project files...\n");
-                    scan_project_files();
-                    load_documentation();
+                    // Again while it runs: stop it
+                    if (scan.running) {
+                        cancel_scan();
+                    } else {
+                        start_scan();
+                    }
                     break;
                 case 'p':
                     if (docs.file_count > 0) {
-                        print_file_documentation(&docs.files[docs.current_selection]);
+                        print_file_documentation(docs.files[docs.current_selection]);
                     }
                     break;
                 case 'P':
                     if (docs.file_count > 0) {
-                        save_printable_documentation(&docs.files[docs.current_selection]);
+                        save_printable_documentation(docs.files[docs.current_selection]);
                     }
                     break;
                 case 's':
-                    get_string_input("Search term: ", docs.search_term, MAX_NAME_LENGTH);
+                    // Results follow the query as it is typed
+                    docs.search_term[0] = '\0';
+                    perform_search(docs.search_term);
+                    docs.search_source = SEARCH_QUERY;
+                    docs.search_editing = 1;
+                    docs.state = STATE_SEARCH;
+                    docs.current_selection = 0;
+                    break;
+                case 'f':
+                    get_string_input("Find function: ", docs.search_term, MAX_NAME_LENGTH);
                     if (strlen(docs.search_term) > 0) {
-                        perform_search(docs.search_term);
+                        fuzzy_search(docs.search_term);
+                        docs.search_source = SEARCH_FUZZY;
                         docs.state = STATE_SEARCH;
                         docs.current_selection = 0;
                     }
                     break;
+                case 'g':
+                    goto_symbol();
+                    break;
                 case 'u':
                     find_undocumented_functions();
                     docs.state = STATE_UNDOCUMENTED;
                     docs.current_selection = 0;
                     break;
-                case '\033': // Arrow keys
-                    getchar(); // skip [
-                    switch (getchar()) {
-                        case 'A': // Up
-                            if (docs.current_selection > 0) docs.current_selection--;
-                            break;
-                        case 'B': // Down
-                            if (docs.current_selection < docs.file_count - 1) docs.current_selection++;
-                            break;
-                    }
+                case '\033': // Arrow and paging keys
+                    move_selection(read_escape_key(), docs.file_count);
                     break;
                 case '\n':
                 case '\r':
@@ -1254,21 +6051,12 @@ void handle_input() {
                     docs.state = STATE_FILES;
                     docs.current_selection = docs.current_file;
                     break;
-                case '\033': // Arrow keys
-                    getchar(); // skip [
-                    switch (getchar()) {
-                        case 'A': // Up
-                            if (docs.current_selection > 0) docs.current_selection--;
-                            break;
-                        case 'B': // Down
-                            if (docs.current_selection < docs.files[docs.current_file].function_count - 1) 
-                                docs.current_selection++;
-                            break;
-                    }
+                case '\033': // Arrow and paging keys
+                    move_selection(read_escape_key(), docs.files[docs.current_file]->function_count);
                     break;
                 case '\n':
                 case '\r':
-                    if (docs.files[docs.current_file].function_count > 0) {
+                    if (docs.files[docs.current_file]->function_count > 0) {
                         docs.current_function = docs.current_selection;
                         docs.state = STATE_FUNCTION_DETAIL;
                     }
@@ -1283,13 +6071,21 @@ void handle_input() {
                     docs.current_selection = docs.current_function;
                     break;
                 case 'e':
-                    edit_function_documentation(&docs.files[docs.current_file].functions[docs.current_function]);
+                    edit_function_documentation(&docs.files[docs.current_file]->functions[docs.current_function]);
+                    break;
+                case 'c':
+                    show_cross_references(&docs.files[docs.current_file]->functions[docs.current_function],
+                                          SEARCH_CALLERS);
+                    break;
+                case 'C':
+                    show_cross_references(&docs.files[docs.current_file]->functions[docs.current_function],
+                                          SEARCH_CALLEES);
                     break;
                 case 'v':
                     clear_screen();
                     display_header();
-                    function_t *func = &docs.files[docs.current_file].functions[docs.current_function];
-                    printf(BOLD GREEN "\nSOURCE CODE: %s\n" RESET, func->name);
+                    function_t *func = &docs.files[docs.current_file]->functions[docs.current_function];
+                    printf(BOLD GREEN "\nSOURCE CODE: %s\n" RESET, str(func->name));
                     print_function_source(func);
                     printf("\nPress any key to continue...");
                     getchar();
@@ -1298,29 +6094,41 @@ void handle_input() {
             break;
             
         case STATE_SEARCH:
+            if (docs.search_editing && edit_search_query(c)) break;
             switch (c) {
-                case 'b':
-                    docs.state = STATE_FILES;
-                    docs.current_selection = 0;
-                    break;
-                case '\033': // Arrow keys
-                    getchar(); // skip [
-                    switch (getchar()) {
-                        case 'A': // Up
-                            if (docs.current_selection > 0) docs.current_selection--;
-                            break;
-                        case 'B': // Down
-                            if (docs.current_selection < docs.search_count - 1) docs.current_selection++;
-                            break;
+                case 'b': {
+                    // Cross references go back to the function they are about
+                    function_t *func = docs.search_source == SEARCH_CALLERS || docs.search_source == SEARCH_CALLEES
+                                       ? find_function(docs.xref_file, docs.xref_name) : NULL;
+                    int file_idx = func ? find_file_index(str(func->filename)) : -1;
+                    if (file_idx >= 0) {
+                        docs.current_file = file_idx;
+                        docs.current_function = func - docs.files[file_idx]->functions;
+                        docs.state = STATE_FUNCTION_DETAIL;
+                    } else {
+                        docs.state = STATE_FILES;
+                        docs.current_selection = 0;
                     }
                     break;
+                }
+                case 's':
+                    if (docs.search_source == SEARCH_QUERY) docs.search_editing = 1;
+                    break;
+                case '\033': { // Arrow and paging keys; ←/→ page too
+                    nav_key_t key = read_escape_key();
+                    if (key == KEY_RIGHT) key = KEY_PAGE_DOWN;
+                    if (key == KEY_LEFT) key = KEY_PAGE_UP;
+                    move_selection(key, docs.search_count);
+                    break;
+                }
                 case '\n':
                 case '\r':
                     if (docs.search_count > 0) {
-                        int result = docs.search_results[docs.current_selection];
-                        docs.current_file = result / 1000;
-                        docs.current_function = result % 1000;
+                        func_ref_t ref = docs.search_results[docs.current_selection];
+                        docs.current_file = ref.file;
+                        docs.current_function = ref.func;
                         docs.state = STATE_FUNCTION_DETAIL;
+                        docs.search_editing = 0;
                     }
                     break;
             }
@@ -1332,16 +6140,8 @@ void handle_input() {
                     docs.state = STATE_FILES;
                     docs.current_selection = 0;
                     break;
-                case '\033': // Arrow keys
-                    getchar(); // skip [
-                    switch (getchar()) {
-                        case 'A': // Up
-                            if (docs.current_selection > 0) docs.current_selection--;
-                            break;
-                        case 'B': // Down
-                            if (docs.current_selection < docs.undocumented_count - 1) docs.current_selection++;
-                            break;
-                    }
+                case '\033': // Arrow and paging keys
+                    move_selection(read_escape_key(), docs.undocumented_count);
                     break;
                 case '\n':
                 case '\r':
@@ -1361,6 +6161,7 @@ void handle_input() {
 
 int main(int argc, char *argv[]) {
     // Initialize
+    intern("");  // id 0, what zeroed records refer to
     docs.file_count = 0;
     docs.current_file = 0;
     docs.current_function = 0;
@@ -1368,29 +6169,62 @@ int main(int argc, char *argv[]) {
     docs.state = STATE_FILES;
     
     // Handle command line arguments
-    if (argc > 1) {
-        if (chdir(argv[1]) != 0) {
+    int watch_mode = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "wf:")) != -1) {
+        switch (opt) {
+            case 'w':
+                watch_mode = 1;
+                break;
+            case 'f':
+                if (strcmp(optarg, "always") == 0) {
+                    journal.fsync_policy = FSYNC_ALWAYS;
+                } else if (strcmp(optarg, "group") == 0) {
+                    journal.fsync_policy = FSYNC_GROUP;
+                } else if (strcmp(optarg, "never") == 0) {
+                    journal.fsync_policy = FSYNC_NEVER;
+                } else {
+                    printf("Unknown fsync policy '%s' (use always, group or never)\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                printf("Usage: %s [-w] [-f always|group|never] [project_directory]\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    if (optind < argc) {
+        if (chdir(argv[optind]) != 0) {
             perror("Failed to change to specified directory");
-            printf("Usage: %s [project_directory]\n", argv[0]);
+            printf("Usage: %s [-w] [-f always|group|never] [project_directory]\n", argv[0]);
             return 1;
         }
-        printf("Changed to directory: %s\n", argv[1]);
+        printf("Changed to directory: %s\n", argv[optind]);
     }
     
-    printf("Scanning C files in current directory...\n");
-    scan_project_files();
-    load_documentation();
-    
-    if (docs.file_count == 0) {
-        printf("No C files found in current directory.\n");
-        printf("Make sure you're running this from your project directory containing .c and .h files.\n");
+    if (pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("Failed to create a pipe");
         return 1;
     }
     
+    // Fold the journal back into the docs file on the way out
+    atexit(compact_documentation);
+    
+    // Keys are read straight from the fd so poll() and getchar() agree
+    setvbuf(stdin, NULL, _IONBF, 0);
+    
     enable_raw_mode();
+    init_screen();
+    
+    // The list fills in while the first frames are up; watching starts
+    // once the scan has found every directory
+    watch.requested = watch_mode;
+    start_scan();
     
     // Main loop
     while (1) {
+        begin_frame();
         switch (docs.state) {
             case STATE_FILES:
                 display_files();
@@ -1408,7 +6242,15 @@ int main(int argc, char *argv[]) {
                 display_undocumented();
                 break;
         }
+        end_frame();
         
+        // Build the background indexes while waiting for a key, once the
+        // file list has settled
+        if (!scan.running) ensure_background_indexes();
+        if (!wait_for_key()) {
+            apply_updates();
+            continue;
+        }
         handle_input();
     }
     